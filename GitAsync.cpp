@@ -0,0 +1,613 @@
+#include "GitAsync.h"
+
+#include <algorithm>
+#include <map>
+
+#include "GitCommands.h"
+#include "GitStats.h"
+#include "GitStrUtil.h"
+
+namespace
+{
+    constexpr std::chrono::milliseconds PollInterval(10);
+}
+
+GitAsync::ThreadPoolExecutor::ThreadPoolExecutor(size_t threadCount)
+    : busyCount(0)
+    , isStopping(false)
+{
+    pool.reserve(threadCount);
+
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        pool.emplace_back([this]() { Loop(); });
+    }
+}
+
+GitAsync::ThreadPoolExecutor::~ThreadPoolExecutor()
+{
+    Shutdown();
+}
+
+void GitAsync::ThreadPoolExecutor::Shutdown()
+{
+    std::call_once(shutdownOnce, [this]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(lockObj);
+                isStopping = true;
+            }
+
+            wakeUp.notify_all();
+
+            for (auto& thread : pool)
+            {
+                thread.join();
+            }
+        });
+}
+
+void GitAsync::ThreadPoolExecutor::Post(std::function<void()> work)
+{
+    bool isQueued = false;
+
+    {
+        std::lock_guard<std::mutex> lock(lockObj);
+
+        if (!isStopping)
+        {
+            queue.push_back(std::move(work));
+            isQueued = true;
+        }
+    }
+
+    // Nobody would pick it up any more, and dropping it would leave a coroutine suspended forever.
+    if (!isQueued)
+    {
+        work();
+        return;
+    }
+
+    wakeUp.notify_one();
+}
+
+void GitAsync::ThreadPoolExecutor::Loop()
+{
+    while (true)
+    {
+        std::function<void()> work;
+
+        {
+            std::unique_lock<std::mutex> lock(lockObj);
+            wakeUp.wait(lock, [this]() { return isStopping || !queue.empty(); });
+
+            if (queue.empty())
+                return;
+
+            work = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // The pool size never changes, so the peak counts the threads that were busy at the same time.
+        GitStats::UpdatePeakThreads(++busyCount);
+        work();
+        --busyCount;
+    }
+}
+
+GitAsync::Semaphore::Semaphore(Executor& executor, size_t count)
+    : executor(executor)
+    , count(count)
+{
+}
+
+bool GitAsync::Semaphore::Enqueue(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock(lockObj);
+
+    if (count > 0)
+    {
+        --count;
+        return false;
+    }
+
+    waiters.push_back(handle);
+    return true;
+}
+
+void GitAsync::Semaphore::Release()
+{
+    std::coroutine_handle<> next;
+
+    {
+        std::lock_guard<std::mutex> lock(lockObj);
+
+        if (waiters.empty())
+        {
+            ++count;
+            return;
+        }
+
+        next = waiters.front();
+        waiters.pop_front();
+    }
+
+    // The slot passes straight to the waiter, which resumes on the executor rather than deep inside this call.
+    executor.Post([next]() { next.resume(); });
+}
+
+struct GitAsync::Engine::Operation
+{
+    std::string command;
+    GitUtil::CancelToken token;
+    CommandResult* result;
+    std::coroutine_handle<> handle;
+    OSUtil::ChildProcess child;
+    GitStats::Clock::time_point startTime;
+};
+
+GitAsync::Engine::CallScope::CallScope(Engine& engine)
+    : engine(engine)
+{
+    std::lock_guard<std::mutex> lock(engine.lockObj);
+    ++engine.callCount;
+}
+
+GitAsync::Engine::CallScope::~CallScope()
+{
+    // Notified under the lock: Shutdown may return, and the engine go away, as soon as it is released.
+    std::lock_guard<std::mutex> lock(engine.lockObj);
+
+    if (--engine.callCount == 0)
+    {
+        engine.callsDone.notify_all();
+    }
+}
+
+GitAsync::Engine::Engine(Executor& executor, size_t maxProcesses)
+    : executor(executor)
+    , maxProcesses(std::max<size_t>(maxProcesses, 1))
+    , activeCount(0)
+    , callCount(0)
+    , isStopping(false)
+{
+    reactor = std::thread([this]() { Loop(); });
+}
+
+GitAsync::Engine::~Engine()
+{
+    Shutdown();
+}
+
+void GitAsync::Engine::Shutdown()
+{
+    std::call_once(shutdownOnce, [this]()
+        {
+            {
+                std::lock_guard<std::mutex> lock(lockObj);
+                isStopping = true;
+            }
+
+            wakeUp.notify_all();
+            reactor.join();
+        });
+
+    // Cancelled calls, and calls made after an earlier Shutdown, resume on the executor and still use the engine.
+    std::unique_lock<std::mutex> lock(lockObj);
+    callsDone.wait(lock, [this]() { return callCount == 0; });
+}
+
+void GitAsync::Engine::Submit(std::string command, const GitUtil::CancelToken& token, CommandResult* result
+    , std::coroutine_handle<> handle)
+{
+    auto operation = std::make_unique<Operation>();
+    operation->command = std::move(command);
+    operation->token = token;
+    operation->result = result;
+    operation->handle = handle;
+
+    {
+        std::lock_guard<std::mutex> lock(lockObj);
+
+        if (!isStopping)
+        {
+            pending.push_back(std::move(operation));
+
+            // Notified under the lock: once the call has been picked up, it may finish and the engine go away.
+            wakeUp.notify_one();
+        }
+    }
+
+    if (operation)
+    {
+        Complete(*operation, OSUtil::ExecStatus::Cancelled);
+    }
+}
+
+void GitAsync::Engine::Complete(Operation& operation, OSUtil::ExecStatus status)
+{
+    operation.result->status = status;
+    operation.result->output = operation.child.TakeOutput();
+
+    if (operation.startTime != GitStats::Clock::time_point())
+    {
+        operation.result->elapsed = GitStats::Clock::now() - operation.startTime;
+    }
+
+    if (status == OSUtil::ExecStatus::TimedOut)
+    {
+        GitStats::Increment(GitStats::Counter::TimedOut);
+    }
+    else if (status == OSUtil::ExecStatus::Cancelled)
+    {
+        GitStats::Increment(GitStats::Counter::Cancelled);
+    }
+
+    auto handle = operation.handle;
+    executor.Post([handle]() { handle.resume(); });
+}
+
+void GitAsync::Engine::Loop()
+{
+    std::vector<std::unique_ptr<Operation>> active;
+    std::vector<std::unique_ptr<Operation>> started;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(lockObj);
+
+            if (active.empty())
+            {
+                wakeUp.wait(lock, [this]() { return isStopping || !pending.empty(); });
+            }
+
+            if (isStopping)
+                break;
+
+            while (!pending.empty() && active.size() + started.size() < maxProcesses)
+            {
+                started.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+
+        for (auto& operation : started)
+        {
+            auto& token = operation->token;
+
+            if (token.IsCancelled())
+            {
+                Complete(*operation, token.IsDeadlinePassed() ? OSUtil::ExecStatus::TimedOut : OSUtil::ExecStatus::Cancelled);
+                continue;
+            }
+
+            operation->startTime = GitStats::Clock::now();
+
+            if (!operation->child.Start(operation->command.c_str(), token))
+            {
+                Complete(*operation, OSUtil::ExecStatus::Failed);
+                continue;
+            }
+
+            active.push_back(std::move(operation));
+        }
+
+        started.clear();
+
+        bool hasPendingOutput = false;
+
+        // Killed children are only terminated here and reaped by a later Poll, so one slow exit never stalls the rest.
+        for (size_t i = 0; i < active.size();)
+        {
+            auto& operation = *active[i];
+
+            if (!operation.child.Poll())
+            {
+                hasPendingOutput = hasPendingOutput || operation.child.HasPendingOutput();
+                ++i;
+                continue;
+            }
+
+            Complete(operation, operation.child.GetStatus());
+
+            active[i] = std::move(active.back());
+            active.pop_back();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(lockObj);
+            activeCount = active.size();
+        }
+
+        if (!active.empty() && !hasPendingOutput)
+        {
+            std::unique_lock<std::mutex> lock(lockObj);
+            wakeUp.wait_for(lock, PollInterval, [this]()
+                {
+                    return isStopping || (!pending.empty() && activeCount < maxProcesses);
+                });
+        }
+    }
+
+    std::deque<std::unique_ptr<Operation>> remaining;
+
+    {
+        std::lock_guard<std::mutex> lock(lockObj);
+        remaining.swap(pending);
+    }
+
+    // Terminate everything first so the waits in Kill overlap instead of adding up.
+    for (auto& operation : active)
+    {
+        operation->child.Terminate(OSUtil::ExecStatus::Cancelled);
+    }
+
+    for (auto& operation : active)
+    {
+        operation->child.Kill(OSUtil::ExecStatus::Cancelled);
+        Complete(*operation, OSUtil::ExecStatus::Cancelled);
+    }
+
+    for (auto& operation : remaining)
+    {
+        Complete(*operation, OSUtil::ExecStatus::Cancelled);
+    }
+}
+
+namespace
+{
+    using namespace GitAsync;
+
+    Task<bool> RunFile(Engine& engine, const Git::CommandTemplate& command, std::string rootPath, std::string fileFullPath
+        , std::shared_ptr<Semaphore> slot, std::string successPrefix, ProgressCallback onProgress, GitUtil::CancelToken token)
+    {
+        if (rootPath.empty())
+        {
+            GitStats::Increment(GitStats::Counter::Failed);
+
+            if (onProgress)
+            {
+                onProgress(fileFullPath, false, "Not in a git repository.\n");
+            }
+
+            co_return false;
+        }
+
+        auto filePath = GitCommand::RelativePath(rootPath, fileFullPath);
+        auto commandLine = GitCommand::Build(command, rootPath, filePath);
+
+        // Waiting for a slot of a busy remote is queueing too.
+        auto queuedTime = GitStats::IsEnabled() ? GitStats::Clock::now() : GitStats::Clock::time_point();
+        co_await slot->Acquire();
+
+        if (GitStats::IsEnabled())
+        {
+            GitStats::AddTime(GitStats::Phase::Queueing, GitStats::Clock::now() - queuedTime);
+        }
+
+        auto result = co_await engine.Run(std::move(commandLine), std::move(token));
+        slot->Release();
+
+        // Only lock/unlock calls are request samples; discovery calls are timed under their own phase.
+        GitStats::Increment(GitStats::Counter::Requests);
+
+        if (GitStats::IsEnabled())
+        {
+            GitStats::AddTime(GitStats::Phase::Request, result.elapsed);
+        }
+
+        auto isSucceeded = (result.status != OSUtil::ExecStatus::TimedOut)
+            && (result.status != OSUtil::ExecStatus::Cancelled)
+            && StrUtil::starts_with(result.output, successPrefix);
+
+        GitStats::Increment(isSucceeded ? GitStats::Counter::Succeeded : GitStats::Counter::Failed);
+
+        if (onProgress)
+        {
+            onProgress(fileFullPath, isSucceeded, result.output);
+        }
+
+        co_return isSucceeded;
+    }
+
+    // Every file is submitted up front; the per-remote slots and the engine decide how many git children run at once.
+    Task<size_t> RunBatch(Engine& engine, const Git::CommandTemplate& command, std::vector<GitUtil::RepoGroup> groups
+        , std::string successPrefix, ProgressCallback onProgress, GitUtil::CancelToken token)
+    {
+        auto plan = GitUtil::PlanBatch(groups);
+
+        // Shared with the files, which release their slot after this batch may already have given up on them.
+        std::vector<std::shared_ptr<Semaphore>> slots;
+        slots.reserve(plan.slotCount);
+
+        for (size_t i = 0; i < plan.slotCount; ++i)
+        {
+            slots.push_back(std::make_shared<Semaphore>(engine.GetExecutor(), Git::MaxRequestsPerRemote));
+        }
+
+        std::vector<Task<bool>> tasks;
+        tasks.reserve(plan.entries.size());
+
+        for (auto& entry : plan.entries)
+        {
+            if (token.IsCancelled())
+                break;
+
+            tasks.push_back(RunFile(engine, command, entry.group->rootPath, *entry.fileFullPath, slots[entry.slotIndex]
+                , successPrefix, onProgress, token));
+        }
+
+        GitUtil::CountUnscheduled(token, plan.entries.size() - tasks.size());
+
+        size_t count = 0;
+        std::exception_ptr error;
+
+        // A throwing progress callback fails its own file only; the rest still run to the end before it is rethrown.
+        for (auto& task : tasks)
+        {
+            try
+            {
+                if (co_await task)
+                {
+                    ++count;
+                }
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        co_return count;
+    }
+}
+
+GitAsync::Task<std::string> GitAsync::Engine::GetOriginUrl(std::string rootPath, GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto result = co_await Run(GitCommand::Build(Git::Template::GetOriginUrl, rootPath), std::move(token));
+
+    if (GitStats::IsEnabled())
+    {
+        GitStats::AddTime(GitStats::Phase::Discovery, result.elapsed);
+    }
+
+    StrUtil::Trim(result.output);
+
+    co_return std::move(result.output);
+}
+
+GitAsync::Task<std::vector<GitUtil::RepoGroup>> GitAsync::Engine::GroupByRepo(std::vector<std::string> fileFullPathList
+    , GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto groups = GitUtil::GroupByRepoRoot(fileFullPathList);
+
+    std::vector<std::pair<size_t, Task<std::string>>> lookups;
+    lookups.reserve(groups.size());
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        if (!groups[i].rootPath.empty())
+        {
+            lookups.emplace_back(i, GetOriginUrl(groups[i].rootPath, token));
+        }
+    }
+
+    for (auto& lookup : lookups)
+    {
+        groups[lookup.first].originUrl = co_await lookup.second;
+    }
+
+    co_return groups;
+}
+
+GitAsync::Task<bool> GitAsync::Engine::IsLocked(std::string rootPath, std::string fileFullPath, GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto filePath = GitCommand::RelativePath(rootPath, fileFullPath);
+    auto result = co_await Run(GitCommand::Build(Git::Template::IsLocked, rootPath, filePath), std::move(token));
+
+    StrUtil::Trim(result.output);
+
+    co_return StrUtil::starts_with(result.output, filePath);
+}
+
+GitAsync::Task<bool> GitAsync::Engine::Lock(std::string rootPath, bool isForced, std::vector<std::string> fileFullPathList
+    , ProgressCallback onProgress, GitUtil::CancelToken token)
+{
+    return Lock(isForced, GitUtil::MakeSingleGroup(rootPath, fileFullPathList), std::move(onProgress), std::move(token));
+}
+
+GitAsync::Task<bool> GitAsync::Engine::Unlock(std::string rootPath, bool isForced, std::vector<std::string> fileFullPathList
+    , ProgressCallback onProgress, GitUtil::CancelToken token)
+{
+    return Unlock(isForced, GitUtil::MakeSingleGroup(rootPath, fileFullPathList), std::move(onProgress), std::move(token));
+}
+
+GitAsync::Task<bool> GitAsync::Engine::Lock(bool isForced, std::vector<GitUtil::RepoGroup> groups, ProgressCallback onProgress
+    , GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto& command = !isForced ? Git::Template::LockFile : Git::Template::LockFileForce;
+    auto total = GitUtil::CountFiles(groups);
+
+    auto count = co_await RunBatch(*this, command, std::move(groups), "Locked ", std::move(onProgress), std::move(token));
+
+    co_return count == total;
+}
+
+GitAsync::Task<bool> GitAsync::Engine::Unlock(bool isForced, std::vector<GitUtil::RepoGroup> groups, ProgressCallback onProgress
+    , GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto& command = !isForced ? Git::Template::UnlockFile : Git::Template::UnlockFileForce;
+    auto total = GitUtil::CountFiles(groups);
+
+    auto count = co_await RunBatch(*this, command, std::move(groups), "Unlocked ", std::move(onProgress), std::move(token));
+
+    co_return count == total;
+}
+
+GitAsync::Task<std::vector<GitUtil::LockedFileStatus>> GitAsync::Engine::GetLockedFiles(std::string rootPath
+    , GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    auto result = co_await Run(GitCommand::Build(Git::Template::GetLockedList, rootPath), std::move(token));
+
+    co_return GitUtil::ParseLockedFiles(result.output);
+}
+
+GitAsync::Task<size_t> GitAsync::Engine::UnlockAll(std::string rootPath, bool isForced, ProgressCallback onProgress
+    , GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    std::vector<std::string> fullPathList;
+
+    auto lockedFiles = co_await GetLockedFiles(rootPath, token);
+    for (auto& status : lockedFiles)
+    {
+        if (status.filePath.empty())
+            continue;
+
+        fullPathList.push_back(status.filePath);
+    }
+
+    auto& command = !isForced ? Git::Template::UnlockFile : Git::Template::UnlockFileForce;
+
+    co_return co_await RunBatch(*this, command, GitUtil::MakeSingleGroup(rootPath, fullPathList), "Unlocked "
+        , std::move(onProgress), std::move(token));
+}
+
+GitAsync::Task<size_t> GitAsync::Engine::UnlockAll(std::string rootPath, bool isForced, std::string owner
+    , ProgressCallback onProgress, GitUtil::CancelToken token)
+{
+    CallScope scope(*this);
+    std::vector<std::string> fullPathList;
+
+    auto lockedFiles = co_await GetLockedFiles(rootPath, token);
+    for (auto& status : lockedFiles)
+    {
+        if (status.filePath.empty())
+            continue;
+
+        if (status.owner != owner)
+            continue;
+
+        fullPathList.push_back(status.filePath);
+    }
+
+    auto& command = !isForced ? Git::Template::UnlockFile : Git::Template::UnlockFileForce;
+
+    co_return co_await RunBatch(*this, command, GitUtil::MakeSingleGroup(rootPath, fullPathList), "Unlocked "
+        , std::move(onProgress), std::move(token));
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GitProcess.h"
+#include "GitStats.h"
+#include "GitThreadHelper.h"
+#include "GitUtil.h"
+
+namespace GitAsync
+{
+    class Executor
+    {
+    public:
+        virtual ~Executor() = default;
+        virtual void Post(std::function<void()> work) = 0;
+    };
+
+    class ThreadPoolExecutor : public Executor
+    {
+        std::mutex lockObj;
+        std::condition_variable wakeUp;
+        std::deque<std::function<void()>> queue;
+        std::vector<std::thread> pool;
+        std::atomic<size_t> busyCount;
+        std::once_flag shutdownOnce;
+        bool isStopping;
+
+    public:
+        explicit ThreadPoolExecutor(size_t threadCount);
+        ~ThreadPoolExecutor() override;
+
+        void Post(std::function<void()> work) override;
+
+        // Runs the queued work and joins the threads. Safe to call more than once, but never from one of the
+        // pool threads or while a loader lock is held, e.g. from DllMain or a DLL's static destructors.
+        // Work posted afterwards runs on the posting thread.
+        void Shutdown();
+
+    private:
+        void Loop();
+    };
+
+    template <typename T>
+    class TaskState
+    {
+        std::mutex lockObj;
+        std::condition_variable done;
+        std::optional<T> value;
+        std::exception_ptr exception;
+        std::coroutine_handle<> continuation;
+        bool isReady = false;
+
+    public:
+        void SetValue(T result)
+        {
+            Finish([this, &result]() { value.emplace(std::move(result)); });
+        }
+
+        void SetException(std::exception_ptr error)
+        {
+            Finish([this, &error]() { exception = error; });
+        }
+
+        // Returns false when the result is already there and the awaiter should not suspend.
+        bool SetContinuation(std::coroutine_handle<> handle)
+        {
+            std::lock_guard<std::mutex> lock(lockObj);
+
+            if (isReady)
+                return false;
+
+            continuation = handle;
+            return true;
+        }
+
+        bool IsReady()
+        {
+            std::lock_guard<std::mutex> lock(lockObj);
+            return isReady;
+        }
+
+        T Take()
+        {
+            std::unique_lock<std::mutex> lock(lockObj);
+            done.wait(lock, [this]() { return isReady; });
+
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+
+            return std::move(*value);
+        }
+
+    private:
+        template <typename Func>
+        void Finish(Func store)
+        {
+            std::coroutine_handle<> next;
+
+            {
+                std::lock_guard<std::mutex> lock(lockObj);
+                store();
+                isReady = true;
+                next = continuation;
+            }
+
+            done.notify_all();
+
+            if (next)
+            {
+                next.resume();
+            }
+        }
+    };
+
+    // Starts running as soon as it is created and may be awaited, waited on with Get() or handed to Then() once.
+    // Dropping a Task does not stop it, so a discarded Task is a fire-and-forget operation.
+    template <typename T>
+    class Task
+    {
+        std::shared_ptr<TaskState<T>> state;
+
+    public:
+        struct promise_type
+        {
+            std::shared_ptr<TaskState<T>> state = std::make_shared<TaskState<T>>();
+
+            Task get_return_object() { return Task(state); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_value(T result) { state->SetValue(std::move(result)); }
+            void unhandled_exception() { state->SetException(std::current_exception()); }
+        };
+
+        explicit Task(std::shared_ptr<TaskState<T>> state)
+            : state(std::move(state))
+        {
+        }
+
+        bool IsReady() const { return state->IsReady(); }
+
+        // Blocks the calling thread. Never call it from an executor thread.
+        T Get() { return state->Take(); }
+
+        bool await_ready() const { return state->IsReady(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return state->SetContinuation(handle); }
+        T await_resume() { return state->Take(); }
+    };
+
+    template <typename T>
+    void Then(Task<T> task, std::function<void(T)> onComplete)
+    {
+        [](Task<T> task, std::function<void(T)> onComplete) -> Task<bool>
+        {
+            onComplete(co_await task);
+            co_return true;
+        }(std::move(task), std::move(onComplete));
+    }
+
+    struct CommandResult
+    {
+        OSUtil::ExecStatus status = OSUtil::ExecStatus::Failed;
+        std::string output;
+        GitStats::Clock::duration elapsed = GitStats::Clock::duration::zero();
+    };
+
+    // Coroutine counterpart of Git::Semaphore: a waiter suspends instead of blocking a thread,
+    // and is resumed on the executor once a slot is released to it.
+    class Semaphore
+    {
+        Executor& executor;
+        std::mutex lockObj;
+        std::deque<std::coroutine_handle<>> waiters;
+        size_t count;
+
+    public:
+        class Awaiter
+        {
+            Semaphore& semaphore;
+
+        public:
+            explicit Awaiter(Semaphore& semaphore)
+                : semaphore(semaphore)
+            {
+            }
+
+            bool await_ready() const { return false; }
+            bool await_suspend(std::coroutine_handle<> handle) { return semaphore.Enqueue(handle); }
+            void await_resume() {}
+        };
+
+        Semaphore(Executor& executor, size_t count);
+
+        Semaphore(const Semaphore&) = delete;
+        Semaphore& operator=(const Semaphore&) = delete;
+
+        Awaiter Acquire() { return Awaiter(*this); }
+        void Release();
+
+    private:
+        // Returns false when a slot was free and the caller keeps running.
+        bool Enqueue(std::coroutine_handle<> handle);
+    };
+
+    // Called once per file as soon as its git call finishes, possibly from several executor threads at once.
+    using ProgressCallback = std::function<void(const std::string& fileFullPath, bool isSucceeded, const std::string& message)>;
+
+    // Runs git children from a single reactor thread and resumes the waiting coroutines on the executor,
+    // so any number of outstanding operations only occupy the executor threads while they do real work.
+    // Only a call's own CancelToken and Shutdown stop it; GitUtil::Cancel and the process deadline do not.
+    class Engine
+    {
+        struct Operation;
+
+        // Held by every coroutine that runs on the engine, so Shutdown can wait until none of them uses it any more.
+        class CallScope
+        {
+            Engine& engine;
+
+        public:
+            explicit CallScope(Engine& engine);
+            ~CallScope();
+
+            CallScope(const CallScope&) = delete;
+            CallScope& operator=(const CallScope&) = delete;
+        };
+
+        Executor& executor;
+        size_t maxProcesses;
+
+        std::mutex lockObj;
+        std::condition_variable wakeUp;
+        std::condition_variable callsDone;
+        std::deque<std::unique_ptr<Operation>> pending;
+        size_t activeCount;
+        size_t callCount;
+        bool isStopping;
+        std::once_flag shutdownOnce;
+        std::thread reactor;
+
+    public:
+        class CommandAwaiter
+        {
+            Engine& engine;
+            std::string command;
+            GitUtil::CancelToken token;
+            CommandResult result;
+
+        public:
+            CommandAwaiter(Engine& engine, std::string command, GitUtil::CancelToken token)
+                : engine(engine)
+                , command(std::move(command))
+                , token(std::move(token))
+            {
+            }
+
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { engine.Submit(std::move(command), token, &result, handle); }
+            CommandResult await_resume() { return std::move(result); }
+        };
+
+        // The engine is owned by the caller and the executor must outlive it. Destroying it calls Shutdown.
+        Engine(Executor& executor, size_t maxProcesses = Git::MaxThreads);
+        ~Engine();
+
+        Engine(const Engine&) = delete;
+        Engine& operator=(const Engine&) = delete;
+
+        // Kills outstanding git calls and completes them as cancelled, then waits until every Task this engine returned
+        // has finished with it; later calls complete as cancelled right away. Safe to call more than once, but never
+        // from an executor thread, from a ProgressCallback or under a loader lock. A coroutine of your own that awaits
+        // Run must not touch the engine once it has been shut down.
+        void Shutdown();
+
+        Executor& GetExecutor() { return executor; }
+        CommandAwaiter Run(std::string command, GitUtil::CancelToken token = GitUtil::CancelToken())
+        {
+            return CommandAwaiter(*this, std::move(command), std::move(token));
+        }
+
+        Task<std::string> GetOriginUrl(std::string rootPath, GitUtil::CancelToken token = GitUtil::CancelToken());
+
+        // Same groups as GitUtil::GroupByRepo, with the origin lookups running side by side on this engine.
+        Task<std::vector<GitUtil::RepoGroup>> GroupByRepo(std::vector<std::string> fileFullPathList
+            , GitUtil::CancelToken token = GitUtil::CancelToken());
+
+        Task<bool> IsLocked(std::string rootPath, std::string fileFullPath, GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<bool> Lock(std::string rootPath, bool isForced, std::vector<std::string> fileFullPathList
+            , ProgressCallback onProgress = ProgressCallback(), GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<bool> Unlock(std::string rootPath, bool isForced, std::vector<std::string> fileFullPathList
+            , ProgressCallback onProgress = ProgressCallback(), GitUtil::CancelToken token = GitUtil::CancelToken());
+
+        // Groups sharing an origin share Git::MaxRequestsPerRemote concurrent calls, as in the blocking batches.
+        // An exception thrown by onProgress is rethrown from the Task once every file of the batch has finished.
+        Task<bool> Lock(bool isForced, std::vector<GitUtil::RepoGroup> groups, ProgressCallback onProgress = ProgressCallback()
+            , GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<bool> Unlock(bool isForced, std::vector<GitUtil::RepoGroup> groups, ProgressCallback onProgress = ProgressCallback()
+            , GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<std::vector<GitUtil::LockedFileStatus>> GetLockedFiles(std::string rootPath
+            , GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<size_t> UnlockAll(std::string rootPath, bool isForced, ProgressCallback onProgress = ProgressCallback()
+            , GitUtil::CancelToken token = GitUtil::CancelToken());
+        Task<size_t> UnlockAll(std::string rootPath, bool isForced, std::string owner
+            , ProgressCallback onProgress = ProgressCallback(), GitUtil::CancelToken token = GitUtil::CancelToken());
+
+    private:
+        void Submit(std::string command, const GitUtil::CancelToken& token, CommandResult* result, std::coroutine_handle<> handle);
+        void Complete(Operation& operation, OSUtil::ExecStatus status);
+        void Loop();
+    };
+}
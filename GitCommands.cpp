@@ -0,0 +1,90 @@
+#include "GitCommands.h"
+
+#include "GitProcess.h"
+
+namespace GitCommand
+{
+    std::string_view RelativePath(std::string_view rootPath, std::string_view fullPath)
+    {
+        if (fullPath.size() > rootPath.size() && fullPath[rootPath.size()] == '/'
+            && fullPath.compare(0, rootPath.size(), rootPath) == 0)
+        {
+            return fullPath.substr(rootPath.size() + 1);
+        }
+
+        return fullPath;
+    }
+
+    std::string Build(const Git::CommandTemplate& command, std::string_view rootPath, std::string_view filePath)
+    {
+        auto GetValue = [rootPath, filePath](Git::Placeholder placeholder)
+        {
+            switch (placeholder)
+            {
+            case Git::Placeholder::RootPath:
+                return rootPath;
+            case Git::Placeholder::FilePath:
+                return filePath;
+            default:
+                return std::string_view();
+            }
+        };
+
+        auto NeedQuote = [](std::string_view value)
+        {
+            return value.find(' ') != std::string_view::npos;
+        };
+
+        std::string_view program = OSUtil::GetGitExecutable();
+        if (program.empty())
+        {
+            program = command.args[0].literal;
+        }
+
+        // Size the buffer first so the whole command line costs a single allocation.
+        size_t length = program.size() + (NeedQuote(program) ? 2 : 0);
+
+        for (size_t i = 1; i < command.count; ++i)
+        {
+            auto& arg = command.args[i];
+            auto value = GetValue(arg.placeholder);
+
+            length += 1 + arg.literal.size() + value.size() + (NeedQuote(value) ? 2 : 0);
+        }
+
+        std::string result;
+        result.reserve(length);
+
+        if (NeedQuote(program))
+        {
+            result.append(1, '"').append(program).append(1, '"');
+        }
+        else
+        {
+            result.append(program);
+        }
+
+        for (size_t i = 1; i < command.count; ++i)
+        {
+            auto& arg = command.args[i];
+            auto value = GetValue(arg.placeholder);
+            auto isQuoted = NeedQuote(value);
+
+            result.append(1, ' ');
+
+            if (isQuoted)
+            {
+                result.append(1, '"');
+            }
+
+            result.append(arg.literal).append(value);
+
+            if (isQuoted)
+            {
+                result.append(1, '"');
+            }
+        }
+
+        return result;
+    }
+}
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
 namespace Git
 {
     constexpr auto GetRepoRootPath = "git rev-parse --show-toplevel";
@@ -10,4 +16,112 @@ namespace Git
     constexpr auto LockFileForce = "git -C <root path> lfs lock -f <file path>";
     constexpr auto UnlockFile = "git -C <root path> lfs unlock <file path>";
     constexpr auto UnlockFileForce = "git -C <root path> lfs unlock -f <file path>";
+
+    enum class Placeholder
+    {
+        None,
+        RootPath,
+        FilePath
+    };
+
+    // One argument of a command: a literal prefix optionally followed by a placeholder, e.g. "--path=<file path>".
+    struct CommandArg
+    {
+        std::string_view literal;
+        Placeholder placeholder = Placeholder::None;
+    };
+
+    constexpr size_t MaxCommandArgs = 8;
+
+    struct CommandTemplate
+    {
+        std::array<CommandArg, MaxCommandArgs> args;
+        size_t count = 0;
+    };
+
+    // Throwing from these parsers while a constexpr template is evaluated makes a malformed command a compile error.
+    constexpr Placeholder ParsePlaceholder(std::string_view name)
+    {
+        if (name == "<root path>")
+            return Placeholder::RootPath;
+
+        if (name == "<file path>")
+            return Placeholder::FilePath;
+
+        throw std::invalid_argument("Unknown placeholder in git command");
+    }
+
+    constexpr CommandTemplate ParseCommand(std::string_view command)
+    {
+        CommandTemplate result;
+        size_t pos = 0;
+
+        while (pos < command.size())
+        {
+            if (command[pos] == ' ')
+            {
+                ++pos;
+                continue;
+            }
+
+            if (result.count >= MaxCommandArgs)
+                throw std::invalid_argument("Too many arguments in git command");
+
+            auto& arg = result.args[result.count++];
+            auto start = pos;
+
+            while (pos < command.size() && command[pos] != ' ' && command[pos] != '<')
+            {
+                ++pos;
+            }
+
+            arg.literal = command.substr(start, pos - start);
+
+            if (pos == command.size() || command[pos] != '<')
+                continue;
+
+            // Placeholders may contain spaces and always end the argument.
+            auto end = command.find('>', pos);
+
+            if (end == std::string_view::npos)
+                throw std::invalid_argument("Unterminated placeholder in git command");
+
+            arg.placeholder = ParsePlaceholder(command.substr(pos, end - pos + 1));
+            pos = end + 1;
+
+            if (pos < command.size() && command[pos] != ' ')
+                throw std::invalid_argument("Text after a placeholder in git command");
+        }
+
+        if (result.count == 0)
+            throw std::invalid_argument("Empty git command");
+
+        return result;
+    }
+
+    namespace Template
+    {
+        constexpr auto GetRepoRootPath = ParseCommand(Git::GetRepoRootPath);
+        constexpr auto GetOriginUrl = ParseCommand(Git::GetOriginUrl);
+        constexpr auto GetLockedList = ParseCommand(Git::GetLockedList);
+        constexpr auto IsLocked = ParseCommand(Git::IsLocked);
+        constexpr auto LockFile = ParseCommand(Git::LockFile);
+        constexpr auto LockFileForce = ParseCommand(Git::LockFileForce);
+        constexpr auto UnlockFile = ParseCommand(Git::UnlockFile);
+        constexpr auto UnlockFileForce = ParseCommand(Git::UnlockFileForce);
+
+        static_assert(LockFileForce.count == 7, "git -C <root path> lfs lock -f <file path>");
+        static_assert(LockFileForce.args[2].placeholder == Placeholder::RootPath, "<root path> must be parsed");
+        static_assert(IsLocked.args[5].literal == "--path=", "literal prefix must be kept");
+        static_assert(IsLocked.args[5].placeholder == Placeholder::FilePath, "<file path> must be parsed");
+    }
+}
+
+namespace GitCommand
+{
+    // Only a leading "<root>/" is stripped; paths outside the root are passed through unchanged.
+    std::string_view RelativePath(std::string_view rootPath, std::string_view fullPath);
+
+    std::string Build(const Git::CommandTemplate& command, std::string_view rootPath = std::string_view()
+        , std::string_view filePath = std::string_view());
 }
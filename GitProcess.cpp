@@ -0,0 +1,383 @@
+#include "GitProcess.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <Windows.h>
+
+#include "GitStats.h"
+#include "GitUtil.h"
+
+namespace
+{
+    constexpr DWORD PipeBufferSize = 64 * 1024;
+    constexpr DWORD ReadChunkSize = 4 * 1024;
+    constexpr std::chrono::milliseconds KillWaitTime(5000);
+    constexpr std::chrono::milliseconds PollInterval(20);
+}
+
+OSUtil::ChildProcess::ChildProcess()
+    : process(nullptr)
+    , job(nullptr)
+    , outputPipe(nullptr)
+    , output()
+    , token()
+    , deadline(Clock::time_point::max())
+    , terminateTime()
+    , status(ExecStatus::Failed)
+    , isRunning(false)
+    , isTerminating(false)
+    , hasPendingOutput(false)
+{
+}
+
+OSUtil::ChildProcess::~ChildProcess()
+{
+    Kill(ExecStatus::Cancelled);
+    Close();
+}
+
+bool OSUtil::ChildProcess::Start(const char* command, const GitUtil::CancelToken& token)
+{
+    this->token = token;
+    deadline = GitUtil::GetOperationDeadline(token);
+
+    SECURITY_ATTRIBUTES attributes;
+    memset(&attributes, 0, sizeof(SECURITY_ATTRIBUTES));
+    attributes.nLength = sizeof(SECURITY_ATTRIBUTES);
+    attributes.bInheritHandle = TRUE;
+
+    HANDLE readPipe = nullptr;
+    HANDLE writePipe = nullptr;
+
+    if (!CreatePipe(&readPipe, &writePipe, &attributes, PipeBufferSize))
+        return false;
+
+    SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+    // Only the listed handles are inherited. Otherwise a child started by another thread at the same moment would
+    // also inherit this child's write pipe and hold it open for as long as it runs.
+    HANDLE inheritedHandles[3] = { writePipe, nullptr, nullptr };
+    DWORD inheritedCount = 1;
+
+    auto DuplicateStdHandle = [&inheritedHandles, &inheritedCount](DWORD stdHandle) -> HANDLE
+    {
+        HANDLE source = GetStdHandle(stdHandle);
+        HANDLE duplicate = nullptr;
+
+        if (source == nullptr || source == INVALID_HANDLE_VALUE)
+            return nullptr;
+
+        if (!DuplicateHandle(GetCurrentProcess(), source, GetCurrentProcess(), &duplicate, 0, TRUE, DUPLICATE_SAME_ACCESS))
+            return nullptr;
+
+        inheritedHandles[inheritedCount++] = duplicate;
+        return duplicate;
+    };
+
+    auto inputHandle = DuplicateStdHandle(STD_INPUT_HANDLE);
+    auto errorHandle = DuplicateStdHandle(STD_ERROR_HANDLE);
+
+    SIZE_T attributeListSize = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attributeListSize);
+
+    std::vector<char> attributeListBuffer(attributeListSize);
+    auto attributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.data());
+
+    auto hasAttributeList = InitializeProcThreadAttributeList(attributeList, 1, 0, &attributeListSize);
+    auto isListed = hasAttributeList && UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST
+        , inheritedHandles, inheritedCount * sizeof(HANDLE), nullptr, nullptr);
+
+    STARTUPINFOEXA startupInfo;
+    memset(&startupInfo, 0, sizeof(STARTUPINFOEXA));
+    startupInfo.StartupInfo.cb = sizeof(STARTUPINFOEXA);
+    startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startupInfo.StartupInfo.hStdInput = inputHandle;
+    startupInfo.StartupInfo.hStdOutput = writePipe;
+    startupInfo.StartupInfo.hStdError = errorHandle;
+    startupInfo.lpAttributeList = attributeList;
+
+    PROCESS_INFORMATION processInfo;
+    memset(&processInfo, 0, sizeof(PROCESS_INFORMATION));
+
+    // Only CreateProcessW writes to the command line, so the ANSI version can take it as is.
+    auto isCreated = isListed && CreateProcessA(nullptr, const_cast<char*>(command), nullptr, nullptr, TRUE
+        , CREATE_SUSPENDED | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startupInfo.StartupInfo, &processInfo);
+
+    if (hasAttributeList)
+    {
+        DeleteProcThreadAttributeList(attributeList);
+    }
+
+    for (DWORD i = 0; i < inheritedCount; ++i)
+    {
+        CloseHandle(inheritedHandles[i]);
+    }
+
+    if (!isCreated)
+    {
+        CloseHandle(readPipe);
+        return false;
+    }
+
+    // The child runs inside its own job so that killing it, or this process exiting, also takes down git-lfs.
+    job = CreateJobObjectA(nullptr, nullptr);
+
+    if (job != nullptr)
+    {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limit;
+        memset(&limit, 0, sizeof(JOBOBJECT_EXTENDED_LIMIT_INFORMATION));
+        limit.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+
+        SetInformationJobObject(job, JobObjectExtendedLimitInformation, &limit, sizeof(limit));
+        AssignProcessToJobObject(job, processInfo.hProcess);
+    }
+
+    ResumeThread(processInfo.hThread);
+    CloseHandle(processInfo.hThread);
+
+    process = processInfo.hProcess;
+    outputPipe = readPipe;
+    isRunning = true;
+
+    return true;
+}
+
+bool OSUtil::ChildProcess::Poll()
+{
+    if (!isRunning)
+        return true;
+
+    Drain();
+
+    if (WaitForSingleObject(process, 0) == WAIT_OBJECT_0)
+    {
+        Drain();
+
+        if (!isTerminating)
+        {
+            DWORD exitCode = 1;
+            GetExitCodeProcess(process, &exitCode);
+
+            status = (exitCode == 0) ? ExecStatus::Succeeded : ExecStatus::Failed;
+        }
+
+        isRunning = false;
+        Close();
+
+        return true;
+    }
+
+    if (isTerminating)
+    {
+        // A child that ignores termination is given up on rather than polled forever.
+        if (Clock::now() - terminateTime < KillWaitTime)
+            return false;
+
+        isRunning = false;
+        Close();
+
+        return true;
+    }
+
+    // The operation deadline already includes the token's, so a passed deadline is a timeout, not a cancel.
+    if (Clock::now() >= deadline)
+    {
+        Terminate(ExecStatus::TimedOut);
+    }
+    else if (token.IsCancelled())
+    {
+        // The token's deadline may have passed just after the check above.
+        Terminate(token.IsDeadlinePassed() ? ExecStatus::TimedOut : ExecStatus::Cancelled);
+    }
+
+    return false;
+}
+
+void OSUtil::ChildProcess::Wait(std::chrono::milliseconds timeout)
+{
+    // A child that is still writing gets drained again right away instead of stalling on a full pipe.
+    if (!isRunning || hasPendingOutput)
+        return;
+
+    WaitForSingleObject(process, static_cast<DWORD>(timeout.count()));
+}
+
+void OSUtil::ChildProcess::Terminate(ExecStatus reason)
+{
+    if (!isRunning || isTerminating)
+        return;
+
+    if (job != nullptr)
+    {
+        TerminateJobObject(job, 1);
+    }
+    else
+    {
+        TerminateProcess(process, 1);
+    }
+
+    status = reason;
+    isTerminating = true;
+    terminateTime = Clock::now();
+}
+
+void OSUtil::ChildProcess::Kill(ExecStatus reason)
+{
+    if (!isRunning)
+        return;
+
+    Terminate(reason);
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(terminateTime + KillWaitTime - Clock::now());
+    if (remaining.count() > 0)
+    {
+        WaitForSingleObject(process, static_cast<DWORD>(remaining.count()));
+    }
+
+    Drain();
+
+    isRunning = false;
+    Close();
+}
+
+std::string OSUtil::ChildProcess::TakeOutput()
+{
+    // Match the text mode output popen used to give.
+    output.erase(std::remove(output.begin(), output.end(), '\r'), output.end());
+
+    return std::move(output);
+}
+
+void OSUtil::ChildProcess::Drain()
+{
+    hasPendingOutput = false;
+
+    if (outputPipe == nullptr)
+        return;
+
+    char buffer[ReadChunkSize];
+    DWORD available = 0;
+
+    while (PeekNamedPipe(outputPipe, nullptr, 0, nullptr, &available, nullptr) && available > 0)
+    {
+        DWORD readSize = 0;
+
+        if (!ReadFile(outputPipe, buffer, std::min(available, ReadChunkSize), &readSize, nullptr) || readSize == 0)
+            break;
+
+        output.append(buffer, readSize);
+        hasPendingOutput = true;
+    }
+}
+
+void OSUtil::ChildProcess::Close()
+{
+    if (outputPipe != nullptr)
+    {
+        CloseHandle(outputPipe);
+        outputPipe = nullptr;
+    }
+
+    if (process != nullptr)
+    {
+        CloseHandle(process);
+        process = nullptr;
+    }
+
+    if (job != nullptr)
+    {
+        CloseHandle(job);
+        job = nullptr;
+    }
+}
+
+// GIT_LFS_LOCK_HELPER_GIT replaces the git executable, e.g. with a stand-in for offline benchmarks.
+const std::string& OSUtil::GetGitExecutable()
+{
+    static const std::string executable = []()
+    {
+        constexpr auto Name = "GIT_LFS_LOCK_HELPER_GIT";
+
+        // The first call only reports the size, terminator included, so values of any length fit.
+        auto size = GetEnvironmentVariableA(Name, nullptr, 0);
+
+        if (size == 0)
+        {
+            auto error = GetLastError();
+
+            if (error != ERROR_ENVVAR_NOT_FOUND)
+            {
+                std::cerr << "Cannot read " << Name << " (error " << error << "), using git" << std::endl;
+            }
+
+            return std::string();
+        }
+
+        std::string value(size, '\0');
+        auto length = GetEnvironmentVariableA(Name, value.data(), size);
+
+        if (length == 0 || length >= size)
+        {
+            auto error = GetLastError();
+            std::cerr << "Cannot read " << Name << " (error " << error << "), using git" << std::endl;
+            return std::string();
+        }
+
+        value.resize(length);
+
+        return value;
+    }();
+
+    return executable;
+}
+
+OSUtil::ExecStatus OSUtil::ExecuteCommand(const char* command, std::string& outResult)
+{
+    outResult.clear();
+
+    auto& token = GitUtil::GetProcessToken();
+
+    if (token.IsCancelled())
+    {
+        auto isTimedOut = token.IsDeadlinePassed();
+        GitStats::Increment(isTimedOut ? GitStats::Counter::TimedOut : GitStats::Counter::Cancelled);
+
+        return isTimedOut ? ExecStatus::TimedOut : ExecStatus::Cancelled;
+    }
+
+    ChildProcess child;
+
+    if (!child.Start(command, token))
+        return ExecStatus::Failed;
+
+    while (!child.Poll())
+    {
+        child.Wait(PollInterval);
+    }
+
+    outResult = child.TakeOutput();
+
+    auto status = child.GetStatus();
+
+    if (status == ExecStatus::TimedOut)
+    {
+        GitStats::Increment(GitStats::Counter::TimedOut);
+    }
+    else if (status == ExecStatus::Cancelled)
+    {
+        GitStats::Increment(GitStats::Counter::Cancelled);
+    }
+
+    return status;
+}
+
+std::string OSUtil::ExecuteCommand(const char* command)
+{
+    std::string result;
+    ExecuteCommand(command, result);
+
+    return result;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "GitUtil.h"
+
+namespace OSUtil
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class ExecStatus
+    {
+        Succeeded,
+        Failed,
+        TimedOut,
+        Cancelled
+    };
+
+    class ChildProcess
+    {
+        void* process;
+        void* job;
+        void* outputPipe;
+        std::string output;
+        GitUtil::CancelToken token;
+        Clock::time_point deadline;
+        Clock::time_point terminateTime;
+        ExecStatus status;
+        bool isRunning;
+        bool isTerminating;
+        bool hasPendingOutput;
+
+    public:
+        ChildProcess();
+        ~ChildProcess();
+
+        ChildProcess(const ChildProcess&) = delete;
+        ChildProcess& operator=(const ChildProcess&) = delete;
+
+        // The child is killed once the token is cancelled or its deadline, or the operation timeout, has passed.
+        bool Start(const char* command, const GitUtil::CancelToken& token);
+
+        // Never blocks. Returns true once the child has exited or, after cancellation or its deadline, has been reaped.
+        bool Poll();
+        void Wait(std::chrono::milliseconds timeout);
+
+        // Terminate only starts killing the child and leaves reaping to Poll; Kill also waits for it to go away.
+        void Terminate(ExecStatus reason);
+        void Kill(ExecStatus reason);
+
+        bool IsRunning() const { return isRunning; }
+        bool HasPendingOutput() const { return hasPendingOutput; }
+        ExecStatus GetStatus() const { return status; }
+        std::string TakeOutput();
+
+    private:
+        void Drain();
+        void Close();
+    };
+
+    const std::string& GetGitExecutable();
+
+    // Runs under GitUtil::GetProcessToken().
+    ExecStatus ExecuteCommand(const char* command, std::string& outResult);
+    std::string ExecuteCommand(const char* command);
+}
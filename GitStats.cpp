@@ -0,0 +1,214 @@
+#include "GitStats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include <Windows.h>
+#include <Psapi.h>
+
+namespace GitStats
+{
+    std::atomic<bool> isEnabled(false);
+}
+
+namespace
+{
+    using namespace GitStats;
+
+    constexpr size_t PhaseCount = static_cast<size_t>(Phase::Count);
+    constexpr size_t CounterCount = static_cast<size_t>(Counter::Count);
+
+    const char* const PhaseNames[PhaseCount] = { "discovery", "enumeration", "queueing", "request", "output", "join" };
+    const char* const CounterNames[CounterCount] = { "requests", "succeeded", "failed", "timed_out", "cancelled" };
+
+    Clock::time_point startTime;
+
+    std::atomic<int64_t> phaseTimes[PhaseCount];
+    std::atomic<uint64_t> phaseCounts[PhaseCount];
+    std::atomic<uint64_t> counters[CounterCount];
+    std::atomic<size_t> peakThreads;
+
+    std::mutex latencyLock;
+    std::vector<int64_t> latencies;
+
+    struct LatencySummary
+    {
+        size_t count = 0;
+        double p50 = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    double ToMilliseconds(int64_t nanoseconds)
+    {
+        return static_cast<double>(nanoseconds) / 1000000.0;
+    }
+
+    double GetWallTime()
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime);
+        return ToMilliseconds(elapsed.count());
+    }
+
+    size_t GetPeakWorkingSet()
+    {
+        PROCESS_MEMORY_COUNTERS counters;
+        memset(&counters, 0, sizeof(PROCESS_MEMORY_COUNTERS));
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(PROCESS_MEMORY_COUNTERS)))
+            return 0;
+
+        return counters.PeakWorkingSetSize;
+    }
+
+    LatencySummary GetLatencySummary()
+    {
+        std::vector<int64_t> samples;
+
+        {
+            std::lock_guard<std::mutex> lock(latencyLock);
+            samples = latencies;
+        }
+
+        LatencySummary summary;
+        summary.count = samples.size();
+
+        if (samples.empty())
+            return summary;
+
+        std::sort(samples.begin(), samples.end());
+
+        auto Percentile = [&samples](size_t percent)
+        {
+            auto index = (samples.size() * percent + 99) / 100;
+            index = std::max<size_t>(index, 1) - 1;
+
+            return ToMilliseconds(samples[index]);
+        };
+
+        summary.p50 = Percentile(50);
+        summary.p90 = Percentile(90);
+        summary.p99 = Percentile(99);
+        summary.max = ToMilliseconds(samples.back());
+
+        return summary;
+    }
+}
+
+void GitStats::Enable()
+{
+    startTime = Clock::now();
+    isEnabled.store(true, std::memory_order_relaxed);
+}
+
+void GitStats::AddTime(Phase phase, Clock::duration elapsed)
+{
+    if (!IsEnabled())
+        return;
+
+    auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    auto index = static_cast<size_t>(phase);
+
+    phaseTimes[index].fetch_add(nanoseconds, std::memory_order_relaxed);
+    phaseCounts[index].fetch_add(1, std::memory_order_relaxed);
+
+    if (phase == Phase::Request)
+    {
+        std::lock_guard<std::mutex> lock(latencyLock);
+        latencies.push_back(nanoseconds);
+    }
+}
+
+void GitStats::Increment(Counter counter, size_t amount)
+{
+    if (!IsEnabled())
+        return;
+
+    counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void GitStats::UpdatePeakThreads(size_t threadCount)
+{
+    if (!IsEnabled())
+        return;
+
+    auto peak = peakThreads.load(std::memory_order_relaxed);
+
+    while (peak < threadCount && !peakThreads.compare_exchange_weak(peak, threadCount, std::memory_order_relaxed))
+    {
+    }
+}
+
+void GitStats::PrintSummary(std::ostream& os)
+{
+    auto wallTime = GetWallTime();
+    auto latency = GetLatencySummary();
+
+    os << std::fixed << std::setprecision(3);
+    os << "Stats" << std::endl;
+    os << " Wall Time: " << wallTime << " ms" << std::endl;
+
+    // Queueing and request time are summed over every worker thread, so they can exceed the wall time.
+    for (size_t i = 0; i < PhaseCount; ++i)
+    {
+        os << " Phase " << PhaseNames[i] << ": " << ToMilliseconds(phaseTimes[i].load())
+            << " ms (" << phaseCounts[i].load() << ")" << std::endl;
+    }
+
+    for (size_t i = 0; i < CounterCount; ++i)
+    {
+        os << " Counter " << CounterNames[i] << ": " << counters[i].load() << std::endl;
+    }
+
+    os << " Request Latency: p50 " << latency.p50 << " ms, p90 " << latency.p90
+        << " ms, p99 " << latency.p99 << " ms, max " << latency.max << " ms" << std::endl;
+
+    if (wallTime > 0.0)
+    {
+        os << " Throughput: " << (latency.count * 1000.0 / wallTime) << " requests/s" << std::endl;
+    }
+
+    os << " Peak Worker Threads: " << peakThreads.load() << std::endl;
+    os << " Peak Working Set: " << (GetPeakWorkingSet() / 1024) << " KB" << std::endl;
+
+    os << std::defaultfloat;
+}
+
+void GitStats::PrintJson(std::ostream& os)
+{
+    auto wallTime = GetWallTime();
+    auto latency = GetLatencySummary();
+
+    os << std::fixed << std::setprecision(3);
+    os << "{\"wall_ms\":" << wallTime;
+
+    os << ",\"phases\":{";
+    for (size_t i = 0; i < PhaseCount; ++i)
+    {
+        os << (i > 0 ? "," : "") << '"' << PhaseNames[i] << "\":{\"total_ms\":"
+            << ToMilliseconds(phaseTimes[i].load()) << ",\"count\":" << phaseCounts[i].load() << '}';
+    }
+    os << '}';
+
+    os << ",\"counters\":{";
+    for (size_t i = 0; i < CounterCount; ++i)
+    {
+        os << (i > 0 ? "," : "") << '"' << CounterNames[i] << "\":" << counters[i].load();
+    }
+    os << '}';
+
+    os << ",\"request_latency_ms\":{\"count\":" << latency.count
+        << ",\"p50\":" << latency.p50 << ",\"p90\":" << latency.p90
+        << ",\"p99\":" << latency.p99 << ",\"max\":" << latency.max << '}';
+
+    os << ",\"throughput_per_s\":" << (wallTime > 0.0 ? latency.count * 1000.0 / wallTime : 0.0);
+    os << ",\"peak_worker_threads\":" << peakThreads.load();
+    os << ",\"peak_working_set_bytes\":" << GetPeakWorkingSet();
+
+    os << '}' << std::endl;
+    os << std::defaultfloat;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+namespace GitStats
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase
+    {
+        Discovery,
+        Enumeration,
+        Queueing,
+        Request,
+        Output,
+        Join,
+        Count
+    };
+
+    enum class Counter
+    {
+        Requests,
+        Succeeded,
+        Failed,
+        TimedOut,
+        Cancelled,
+        Count
+    };
+
+    extern std::atomic<bool> isEnabled;
+
+    inline bool IsEnabled()
+    {
+        return isEnabled.load(std::memory_order_relaxed);
+    }
+
+    void Enable();
+
+    // Request time covers one lock/unlock call and is also kept per sample for the latency percentiles.
+    void AddTime(Phase phase, Clock::duration elapsed);
+    void Increment(Counter counter, size_t amount = 1);
+    void UpdatePeakThreads(size_t threadCount);
+
+    void PrintSummary(std::ostream& os);
+    void PrintJson(std::ostream& os);
+
+    class ScopedSpan
+    {
+        Phase phase;
+        bool isActive;
+        Clock::time_point start;
+
+    public:
+        explicit ScopedSpan(Phase phase)
+            : phase(phase)
+            , isActive(IsEnabled())
+            , start(isActive ? Clock::now() : Clock::time_point())
+        {
+        }
+
+        ~ScopedSpan()
+        {
+            if (isActive)
+            {
+                AddTime(phase, Clock::now() - start);
+            }
+        }
+
+        ScopedSpan(const ScopedSpan&) = delete;
+        ScopedSpan& operator=(const ScopedSpan&) = delete;
+    };
+}
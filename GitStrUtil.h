@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include "GitUtil.h"
+
+namespace StrUtil
+{
+    inline void LeftTrim(std::string& s)
+    {
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch)
+            {
+                return !std::isspace(ch);
+            }));
+    }
+
+    inline void RightTrim(std::string& s)
+    {
+        s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch)
+            {
+                return !std::isspace(ch);
+            }).base(), s.end());
+    }
+
+    inline void Trim(std::string& s)
+    {
+        LeftTrim(s);
+        RightTrim(s);
+    }
+
+    inline std::string LeftTrimCopy(std::string s)
+    {
+        LeftTrim(s);
+        return s;
+    }
+
+    inline std::string RightTrimCopy(std::string s)
+    {
+        RightTrim(s);
+        return s;
+    }
+
+    inline std::string TrimCopy(std::string s)
+    {
+        Trim(s);
+        return s;
+    }
+
+    inline std::string replace_all(const std::string& text, const std::string& pattern, const std::string& replace)
+    {
+        using namespace std;
+
+        string result = text;
+
+        using strsize_t = string::size_type;
+        strsize_t pos = 0;
+        strsize_t offset = 0;
+
+        const auto replaceSize = replace.size();
+
+        while ((pos = result.find(pattern, offset)) != string::npos)
+        {
+            auto cursor = result.begin() + pos;
+            result.replace(cursor, cursor + pattern.size(), replace);
+            offset = pos + replaceSize;
+        }
+
+        return result;
+    }
+
+    inline bool starts_with(std::string_view text, std::string_view pattern)
+    {
+        using strsize_t = std::string_view::size_type;
+        const strsize_t len = pattern.length();
+
+        if (text.length() < len)
+            return false;
+
+        for (strsize_t i = 0; i < len; ++i)
+        {
+            if (text[i] != pattern[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    // Trims whitespace, turns '\' into '/' and collapses every run of separators, in place and in one pass.
+    inline void PathTrim(std::string& s)
+    {
+        auto IsSpace = [](char ch)
+        {
+            return std::isspace(static_cast<unsigned char>(ch)) != 0;
+        };
+
+        using strsize_t = std::string::size_type;
+
+        strsize_t begin = 0;
+        strsize_t end = s.size();
+
+        while (begin < end && IsSpace(s[begin]))
+            ++begin;
+
+        while (end > begin && IsSpace(s[end - 1]))
+            --end;
+
+        strsize_t write = 0;
+        bool isAfterSeparator = false;
+
+        for (strsize_t read = begin; read < end; ++read)
+        {
+            auto ch = s[read];
+            auto isSeparator = (ch == '/' || ch == '\\');
+
+            if (isSeparator && isAfterSeparator)
+                continue;
+
+            s[write++] = isSeparator ? '/' : ch;
+            isAfterSeparator = isSeparator;
+        }
+
+        s.resize(write);
+    }
+
+    inline GitUtil::LockedFileStatus ParseLockedFileResult(std::string& s)
+    {
+        GitUtil::LockedFileStatus status;
+
+        std::string::size_type offset = 0;
+        std::string::size_type newOffset = 0;
+
+
+        {
+            newOffset = s.find('\t', offset + 1);
+
+            if (newOffset != std::string::npos)
+            {
+                auto item = s.substr(offset, newOffset - offset);
+                Trim(item);
+
+                status.filePath = item;
+            }
+            else
+            {
+                return GitUtil::LockedFileStatus();
+            }
+
+            offset = newOffset;
+        }
+
+        {
+            newOffset = s.find('\t', offset + 1);
+
+            if (newOffset != std::string::npos)
+            {
+                auto item = s.substr(offset, newOffset - offset);
+                Trim(item);
+
+                status.owner = item;
+            }
+            else
+            {
+                return GitUtil::LockedFileStatus();
+            }
+
+            offset = newOffset;
+        }
+
+        {
+            auto item = s.substr(offset);
+            Trim(item);
+
+            status.id = item;
+        }
+
+        return std::move(status);
+    }
+}
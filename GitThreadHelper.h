@@ -1,16 +1,53 @@
 #pragma once
 
+#include <condition_variable>
 #include <functional>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "GitStats.h"
 
 namespace Git
 {
     using namespace std;
 
+    // Limits shared by the blocking batches and the coroutine engine.
+    constexpr size_t MaxThreads = 128;
+    constexpr size_t MaxRequestsPerRemote = 64;
+
+    class Semaphore
+    {
+        mutex lockObj;
+        condition_variable signal;
+        size_t count;
+
+    public:
+        Semaphore(size_t count)
+            : lockObj()
+            , count(count)
+        {
+        }
+
+        void Acquire()
+        {
+            unique_lock<mutex> lock(lockObj);
+            signal.wait(lock, [this]() { return count > 0; });
+            --count;
+        }
+
+        void Release()
+        {
+            {
+                lock_guard<mutex> lock(lockObj);
+                ++count;
+            }
+
+            signal.notify_one();
+        }
+    };
+
     class MultiThreadTask
     {
         mutex lockObj;
@@ -35,7 +72,19 @@ namespace Git
             }
 
 
-            pool.emplace_back([func](const string& str) { func(str); }, str);
+            auto queuedTime = GitStats::IsEnabled() ? GitStats::Clock::now() : GitStats::Clock::time_point();
+
+            pool.emplace_back([func, queuedTime](const string& str)
+                {
+                    if (GitStats::IsEnabled())
+                    {
+                        GitStats::AddTime(GitStats::Phase::Queueing, GitStats::Clock::now() - queuedTime);
+                    }
+
+                    func(str);
+                }, str);
+
+            GitStats::UpdatePeakThreads(pool.size());
         }
 
         void WaitForComplete()
@@ -47,6 +96,8 @@ namespace Git
     private:
         void WaitForComplete_NeedLock()
         {
+            GitStats::ScopedSpan span(GitStats::Phase::Join);
+
             for (auto& thread : pool)
             {
                 thread.join();
@@ -8,212 +8,21 @@
 #include <cctype>
 #include <locale>
 #include <iostream>
+#include <map>
 #include <mutex>
+#include <string_view>
 
 #include <Windows.h>
 
 #include "GitCommands.h"
+#include "GitProcess.h"
+#include "GitStats.h"
+#include "GitStrUtil.h"
 #include "GitThreadHelper.h"
 
-#ifdef WIN32
-#define popen _popen
-#define pclose _pclose
-#endif
-
-namespace StrUtil
-{
-    inline void LeftTrim(std::string& s)
-    {
-        s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](int ch)
-            {
-                return !std::isspace(ch);
-            }));
-    }
-
-    inline void RightTrim(std::string& s)
-    {
-        s.erase(std::find_if(s.rbegin(), s.rend(), [](int ch)
-            {
-                return !std::isspace(ch);
-            }).base(), s.end());
-    }
-
-    inline void Trim(std::string& s)
-    {
-        LeftTrim(s);
-        RightTrim(s);
-    }
-
-    inline std::string LeftTrimCopy(std::string s)
-    {
-        LeftTrim(s);
-        return s;
-    }
-
-    inline std::string RightTrimCopy(std::string s)
-    {
-        RightTrim(s);
-        return s;
-    }
-
-    inline std::string TrimCopy(std::string s)
-    {
-        Trim(s);
-        return s;
-    }
-
-    std::string replace_all(const std::string& text, const std::string& pattern, const std::string& replace)
-    {
-        using namespace std;
-
-        string result = text;
-
-        using strsize_t = string::size_type;
-        strsize_t pos = 0;
-        strsize_t offset = 0;
-
-        const auto replaceSize = replace.size();
-
-        while ((pos = result.find(pattern, offset)) != string::npos)
-        {
-            auto cursor = result.begin() + pos;
-            result.replace(cursor, cursor + pattern.size(), replace);
-            offset = pos + replaceSize;
-        }
-
-        return result;
-    }
-
-    bool starts_with(const std::string& text, const std::string& pattern)
-    {
-        using strsize_t = std::string::size_type;
-        const strsize_t len = pattern.length();
-
-        if (text.length() < len)
-            return false;
-
-        for (strsize_t i = 0; i < len; ++i)
-        {
-            if (text[i] != pattern[i])
-                return false;
-        }
-
-        return true;
-    }
-
-    inline void PathTrim(std::string& s)
-    {
-        s = replace_all(s, "\\", "/");
-        s = replace_all(s, "//", "/");
-        Trim(s);
-    }
-
-    inline GitUtil::LockedFileStatus ParseLockedFileResult(std::string& s)
-    {
-        GitUtil::LockedFileStatus status;
-
-        std::string::size_type offset = 0;
-        std::string::size_type newOffset = 0;
-
-
-        {
-            newOffset = s.find('\t', offset + 1);
-
-            if (newOffset != std::string::npos)
-            {
-                auto item = s.substr(offset, newOffset - offset);
-                Trim(item);
-
-                status.filePath = item;
-            }
-            else
-            {
-                return GitUtil::LockedFileStatus();
-            }
-
-            offset = newOffset;
-        }
-
-        {
-            newOffset = s.find('\t', offset + 1);
-
-            if (newOffset != std::string::npos)
-            {
-                auto item = s.substr(offset, newOffset - offset);
-                Trim(item);
-
-                status.owner = item;
-            }
-            else
-            {
-                return GitUtil::LockedFileStatus();
-            }
-
-            offset = newOffset;
-        }
-
-        {
-            auto item = s.substr(offset);
-            Trim(item);
-
-            status.id = item;
-        }
-
-        return std::move(status);
-    }
-}
-
-namespace OSUtil
+bool GitUtil::Exists(const char* path)
 {
-    std::string ExecuteCommand(const char* command)
-    {
-        constexpr size_t MAX_BUFFER = 1024 * 1024;
-        thread_local char resultBuffer[MAX_BUFFER];
-
-        auto fp = popen(command, "r");
-        if (!fp)
-        {
-            return std::string();
-        }
-
-        auto readSize = fread((void*)resultBuffer, sizeof(char), sizeof(resultBuffer) - 1, fp);
-        if (readSize < MAX_BUFFER)
-        {
-            resultBuffer[readSize] = '\0';
-        }
-        else
-        {
-            resultBuffer[MAX_BUFFER - 1] = '\0';
-        }
-
-        std::string result(static_cast<const char*>(resultBuffer));
-        pclose(fp);
-
-        return std::move(result);
-    }
-
-    std::vector<std::string> ExecuteCommandMultiLines(const char* command)
-    {
-        constexpr size_t MAX_BUFFER = 1024 * 4;
-        thread_local char resultBuffer[MAX_BUFFER];
-
-        std::vector<std::string> lines;
-
-        auto fp = popen(command, "r");
-        if (!fp)
-        {
-            return lines;
-        }
-
-        while (auto p = fgets(resultBuffer, MAX_BUFFER, fp))
-        {
-            lines.emplace_back(p);
-        }
-
-        pclose(fp);
-
-        return std::move(lines);
-    }
+    return GetFileAttributesA(path) != INVALID_FILE_ATTRIBUTES;
 }
 
 bool GitUtil::IsDirectory(const char* path)
@@ -310,6 +119,7 @@ namespace
 
 void GitUtil::ListFilesRecursive(std::vector<std::string>& outList, const char* path)
 {
+    GitStats::ScopedSpan span(GitStats::Phase::Enumeration);
     ListFilesRecursiveInternal(outList, "", path);
 }
 
@@ -332,7 +142,10 @@ std::string GitUtil::GetCurrentPath()
 
 std::string GitUtil::GetRepoRoot(const std::string& path)
 {
-    std::string rootPath = OSUtil::ExecuteCommand(Git::GetRepoRootPath);
+    GitStats::ScopedSpan span(GitStats::Phase::Discovery);
+    auto command = GitCommand::Build(Git::Template::GetRepoRootPath);
+
+    std::string rootPath = OSUtil::ExecuteCommand(command.c_str());
     StrUtil::PathTrim(rootPath);
 
     return std::move(rootPath);
@@ -340,8 +153,8 @@ std::string GitUtil::GetRepoRoot(const std::string& path)
 
 std::string GitUtil::GetOriginUrl(const std::string& rootPath)
 {
-    static const std::string command(Git::GetOriginUrl);
-    auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
+    GitStats::ScopedSpan span(GitStats::Phase::Discovery);
+    auto modCommand = GitCommand::Build(Git::Template::GetOriginUrl, rootPath);
 
     std::string url = OSUtil::ExecuteCommand(modCommand.c_str());
     StrUtil::Trim(url);
@@ -349,20 +162,116 @@ std::string GitUtil::GetOriginUrl(const std::string& rootPath)
     return std::move(url);
 }
 
+std::string GitUtil::FindRepoRoot(const std::string& fullPath)
+{
+    GitStats::ScopedSpan span(GitStats::Phase::Discovery);
+
+    // A ".git" directory marks a repository, a ".git" file marks a submodule or worktree.
+    std::string path(fullPath);
+
+    if (!IsDirectory(path.c_str()))
+    {
+        auto pos = path.find_last_of('/');
+        if (pos == std::string::npos)
+            return std::string();
+
+        path.resize(pos);
+    }
+
+    while (!path.empty())
+    {
+        if (Exists((path + "/.git").c_str()))
+            return path;
+
+        auto pos = path.find_last_of('/');
+        if (pos == std::string::npos)
+            break;
+
+        path.resize(pos);
+    }
+
+    return std::string();
+}
+
+std::vector<GitUtil::RepoGroup> GitUtil::GroupByRepo(const std::vector<std::string>& fileFullPathList)
+{
+    auto groups = GroupByRepoRoot(fileFullPathList);
+
+    for (auto& group : groups)
+    {
+        if (!group.rootPath.empty())
+        {
+            group.originUrl = GetOriginUrl(group.rootPath);
+        }
+    }
+
+    return groups;
+}
+
+std::vector<GitUtil::RepoGroup> GitUtil::GroupByRepoRoot(const std::vector<std::string>& fileFullPathList)
+{
+    std::vector<RepoGroup> groups;
+    std::map<std::string, size_t> groupIndices;
+    std::map<std::string, std::string> dirRoots;
+
+    for (auto& file : fileFullPathList)
+    {
+        auto pos = file.find_last_of('/');
+        std::string dir = (pos != std::string::npos) ? file.substr(0, pos) : std::string();
+
+        auto found = dirRoots.find(dir);
+        if (found == dirRoots.end())
+        {
+            found = dirRoots.emplace(dir, FindRepoRoot(file)).first;
+        }
+
+        auto& rootPath = found->second;
+        auto index = groupIndices.find(rootPath);
+
+        if (index == groupIndices.end())
+        {
+            index = groupIndices.emplace(rootPath, groups.size()).first;
+
+            RepoGroup group;
+            group.rootPath = rootPath;
+
+            groups.push_back(std::move(group));
+        }
+
+        groups[index->second].fileFullPathList.push_back(file);
+    }
+
+    return groups;
+}
+
 std::vector<GitUtil::LockedFileStatus> GitUtil::GetLockedFiles(const std::string& rootPath)
 {
-    static const std::string command(Git::GetLockedList);
-    auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
+    auto modCommand = GitCommand::Build(Git::Template::GetLockedList, rootPath);
 
-    auto lockedFiles = OSUtil::ExecuteCommandMultiLines(modCommand.c_str());
+    auto output = OSUtil::ExecuteCommand(modCommand.c_str());
 
+    return ParseLockedFiles(output);
+}
+
+std::vector<GitUtil::LockedFileStatus> GitUtil::ParseLockedFiles(const std::string& output)
+{
     std::vector<GitUtil::LockedFileStatus> results;
 
-    for (auto& file : lockedFiles)
+    std::string::size_type offset = 0;
+
+    while (offset < output.size())
     {
+        auto newOffset = output.find('\n', offset);
+        if (newOffset == std::string::npos)
+        {
+            newOffset = output.size();
+        }
+
+        auto file = output.substr(offset, newOffset - offset);
         StrUtil::Trim(file);
 
         results.emplace_back(StrUtil::ParseLockedFileResult(file));
+        offset = newOffset + 1;
     }
 
     return results;
@@ -370,127 +279,246 @@ std::vector<GitUtil::LockedFileStatus> GitUtil::GetLockedFiles(const std::string
 
 bool GitUtil::IsLocked(const std::string& rootPath, const std::string& fileFullPath)
 {
-    static const std::string command(Git::IsLocked);
-    auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
-    auto filePath = StrUtil::replace_all(fileFullPath, rootPath + "/", "");
+    auto filePath = GitCommand::RelativePath(rootPath, fileFullPath);
+    auto modCommand = GitCommand::Build(Git::Template::IsLocked, rootPath, filePath);
 
-    modCommand = StrUtil::replace_all(modCommand, "<file path>", filePath);
     auto result = OSUtil::ExecuteCommand(modCommand.c_str());
     StrUtil::Trim(result);
 
     return StrUtil::starts_with(result, filePath);
 }
 
-bool GitUtil::Lock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fullPathList)
+std::vector<GitUtil::RepoGroup> GitUtil::MakeSingleGroup(const std::string& rootPath, const std::vector<std::string>& fileFullPathList)
 {
-    Git::MultiThreadTask Task(128);
+    std::vector<RepoGroup> groups(1);
+    groups[0].rootPath = rootPath;
+    groups[0].fileFullPathList = fileFullPathList;
 
-    for (auto& file : fullPathList)
-    {
-        std::cout << "Lock List: " << file << std::endl;
-    }
+    return groups;
+}
+
+size_t GitUtil::CountFiles(const std::vector<RepoGroup>& groups)
+{
+    size_t count = 0;
 
-    auto LockInternal = [rootPath, isForced](const std::string& fileFullPath, std::string& OutMessage)
+    for (auto& group : groups)
     {
-        const std::string command(!isForced ? Git::LockFile : Git::LockFileForce);
+        count += group.fileFullPathList.size();
+    }
 
-        auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
-        auto filePath = StrUtil::replace_all(fileFullPath, rootPath + "/", "");
+    return count;
+}
 
-        modCommand = StrUtil::replace_all(modCommand, "<file path>", filePath);
-        OutMessage.append(OSUtil::ExecuteCommand(modCommand.c_str()));
+GitUtil::BatchPlan GitUtil::PlanBatch(const std::vector<RepoGroup>& groups)
+{
+    BatchPlan plan;
+    plan.entries.reserve(CountFiles(groups));
 
-        return StrUtil::starts_with(OutMessage, "Locked ");
-    };
+    std::map<std::string, size_t> remoteSlots;
+    std::vector<size_t> groupSlots;
+    groupSlots.reserve(groups.size());
 
-    std::mutex lockObj;
-    std::atomic<size_t> count = 0;
+    size_t maxGroupSize = 0;
 
-    for (auto& file : fullPathList)
+    for (auto& group : groups)
     {
-        Task.Add([LockInternal, &Task, &lockObj, &count](const std::string& fullPath) -> bool
-            {
-                std::string msg;
+        auto& key = group.originUrl.empty() ? group.rootPath : group.originUrl;
+        auto slot = remoteSlots.emplace(key, remoteSlots.size()).first;
 
-                if (LockInternal(fullPath, msg))
-                {
-                    ++count;
-                    std::lock_guard<std::mutex> lock(lockObj);
-                    std::cout << "Locked File: " << fullPath << std::endl;
-                    return true;
-                }
-
-                {
-                    std::lock_guard<std::mutex> lock(lockObj);
-                    std::cout << "Lock Failed: " << fullPath << std::endl;
-                    std::cout << msg;
-                }
-
-                return false;
-            }, file);
+        groupSlots.push_back(slot->second);
+        maxGroupSize = std::max(maxGroupSize, group.fileFullPathList.size());
     }
 
-    Task.WaitForComplete();
+    plan.slotCount = remoteSlots.size();
+
+    for (size_t i = 0; i < maxGroupSize; ++i)
+    {
+        for (size_t groupIndex = 0; groupIndex < groups.size(); ++groupIndex)
+        {
+            auto& group = groups[groupIndex];
+            if (i >= group.fileFullPathList.size())
+                continue;
 
-    std::cout << "Lock Result: " << fullPathList.size() << " / " << count << std::endl;
+            plan.entries.push_back({ &group, &group.fileFullPathList[i], groupSlots[groupIndex] });
+        }
+    }
 
-    return fullPathList.size() == count;
+    return plan;
 }
 
-bool GitUtil::Unlock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fullPathList)
+bool GitUtil::CountUnscheduled(const CancelToken& token, size_t count)
 {
-    Git::MultiThreadTask Task(128);
+    auto isTimedOut = token.IsDeadlinePassed();
 
-    for (auto& file : fullPathList)
+    if (count > 0)
     {
-        std::cout << "Unlock List: " << file << std::endl;
+        GitStats::Increment(isTimedOut ? GitStats::Counter::TimedOut : GitStats::Counter::Cancelled, count);
     }
 
-    auto UnlockInternal = [rootPath, isForced](const std::string& fileFullPath, std::string& OutMessage)
+    return isTimedOut;
+}
+
+namespace
+{
+    bool RunBatch(const std::vector<GitUtil::RepoGroup>& groups, const Git::CommandTemplate& command
+        , const std::string& verb, const std::string& doneVerb)
     {
-        static const std::string command(!isForced ? Git::UnlockFile : Git::UnlockFileForce);
+        Git::MultiThreadTask Task(Git::MaxThreads);
 
-        auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
-        auto filePath = StrUtil::replace_all(fileFullPath, rootPath + "/", "");
+        for (auto& group : groups)
+        {
+            for (auto& file : group.fileFullPathList)
+            {
+                std::cout << verb << " List: " << file << std::endl;
+            }
+        }
 
-        modCommand = StrUtil::replace_all(modCommand, "<file path>", filePath);
-        OutMessage = OSUtil::ExecuteCommand(modCommand.c_str());
+        auto plan = GitUtil::PlanBatch(groups);
+        auto total = plan.entries.size();
 
-        return StrUtil::starts_with(OutMessage, "Unlocked ");
-    };
+        std::vector<std::unique_ptr<Git::Semaphore>> slots;
+        slots.reserve(plan.slotCount);
 
-    std::mutex lockObj;
-    std::atomic<size_t> count = 0;
+        for (size_t i = 0; i < plan.slotCount; ++i)
+        {
+            slots.push_back(std::make_unique<Git::Semaphore>(Git::MaxRequestsPerRemote));
+        }
 
-    for (auto& file : fullPathList)
-    {
-        Task.Add([UnlockInternal, &Task, &lockObj, &count](const std::string& fullPath) -> bool
+        const std::string successPrefix = doneVerb + " ";
+
+        auto ExecuteInternal = [&command, &successPrefix](const GitUtil::RepoGroup& group, Git::Semaphore& slot
+            , const std::string& fileFullPath, std::string& OutMessage)
+        {
+            auto& rootPath = group.rootPath;
+
+            if (rootPath.empty())
             {
-                std::string msg;
+                OutMessage = "Not in a git repository.\n";
+                return OSUtil::ExecStatus::Failed;
+            }
 
-                if (UnlockInternal(fullPath, msg))
-                {
-                    ++count;
-                    std::lock_guard<std::mutex> lock(lockObj);
-                    std::cout << "Unlocked File: " << fullPath << std::endl;
-                    return true;
-                }
+            auto filePath = GitCommand::RelativePath(rootPath, fileFullPath);
+            auto modCommand = GitCommand::Build(command, rootPath, filePath);
 
+            // Waiting for a slot of a busy remote is queueing too.
+            {
+                GitStats::ScopedSpan span(GitStats::Phase::Queueing);
+                slot.Acquire();
+            }
+
+            // Only lock/unlock calls are request samples; discovery calls are timed under their own phase.
+            OSUtil::ExecStatus status;
+            {
+                GitStats::ScopedSpan span(GitStats::Phase::Request);
+                GitStats::Increment(GitStats::Counter::Requests);
+
+                status = OSUtil::ExecuteCommand(modCommand.c_str(), OutMessage);
+            }
+
+            slot.Release();
+
+            if (status == OSUtil::ExecStatus::TimedOut || status == OSUtil::ExecStatus::Cancelled)
+                return status;
+
+            return StrUtil::starts_with(OutMessage, successPrefix) ? OSUtil::ExecStatus::Succeeded : OSUtil::ExecStatus::Failed;
+        };
+
+        std::mutex lockObj;
+        std::atomic<size_t> count = 0;
+        std::atomic<size_t> timedOutCount = 0;
+        std::atomic<size_t> cancelledCount = 0;
+        size_t scheduledCount = 0;
+
+        for (auto& entry : plan.entries)
+        {
+            if (GitUtil::IsCancelled())
+                break;
+
+            auto& group = *entry.group;
+            auto slot = slots[entry.slotIndex].get();
+            ++scheduledCount;
+
+            Task.Add([&ExecuteInternal, &group, slot, &lockObj, &count, &timedOutCount, &cancelledCount, &verb, &doneVerb]
+                (const std::string& fullPath) -> bool
                 {
-                    std::lock_guard<std::mutex> lock(lockObj);
-                    std::cout << "Unlock Failed: " << fullPath << std::endl;
-                    std::cout << msg;
-                }
+                    std::string msg;
+                    auto status = ExecuteInternal(group, *slot, fullPath, msg);
+
+                    if (status == OSUtil::ExecStatus::TimedOut || status == OSUtil::ExecStatus::Cancelled)
+                    {
+                        auto isTimedOut = (status == OSUtil::ExecStatus::TimedOut);
+                        ++(isTimedOut ? timedOutCount : cancelledCount);
+
+                        std::lock_guard<std::mutex> lock(lockObj);
+                        GitStats::ScopedSpan span(GitStats::Phase::Output);
+                        std::cout << verb << (isTimedOut ? " Timed Out: " : " Cancelled: ") << fullPath << std::endl;
+                        std::cout << msg;
+                        return false;
+                    }
+
+                    if (status == OSUtil::ExecStatus::Succeeded)
+                    {
+                        ++count;
+                        GitStats::Increment(GitStats::Counter::Succeeded);
+
+                        std::lock_guard<std::mutex> lock(lockObj);
+                        GitStats::ScopedSpan span(GitStats::Phase::Output);
+                        std::cout << doneVerb << " File: " << fullPath << std::endl;
+                        return true;
+                    }
+
+                    GitStats::Increment(GitStats::Counter::Failed);
+
+                    {
+                        std::lock_guard<std::mutex> lock(lockObj);
+                        GitStats::ScopedSpan span(GitStats::Phase::Output);
+                        std::cout << verb << " Failed: " << fullPath << std::endl;
+                        std::cout << msg;
+                    }
+
+                    return false;
+                }, *entry.fileFullPath);
+        }
 
-                return false;
-            }, file);
+        Task.WaitForComplete();
+
+        std::cout << verb << " Result: " << total << " / " << count << std::endl;
+
+        auto unscheduledCount = total - scheduledCount;
+
+        if (unscheduledCount > 0)
+        {
+            auto isTimedOut = GitUtil::CountUnscheduled(GitUtil::GetProcessToken(), unscheduledCount);
+            (isTimedOut ? timedOutCount : cancelledCount) += unscheduledCount;
+        }
+
+        if (timedOutCount > 0 || cancelledCount > 0)
+        {
+            std::cout << verb << " Incomplete: " << timedOutCount << " timed out, " << cancelledCount << " cancelled" << std::endl;
+        }
+
+        return total == count;
     }
+}
+
+bool GitUtil::Lock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fullPathList)
+{
+    return Lock(isForced, MakeSingleGroup(rootPath, fullPathList));
+}
 
-    Task.WaitForComplete();
+bool GitUtil::Unlock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fullPathList)
+{
+    return Unlock(isForced, MakeSingleGroup(rootPath, fullPathList));
+}
 
-    std::cout << "Unlock Result: " << fullPathList.size() << " / " << count << std::endl;
+bool GitUtil::Lock(bool isForced, const std::vector<RepoGroup>& groups)
+{
+    return RunBatch(groups, !isForced ? Git::Template::LockFile : Git::Template::LockFileForce, "Lock", "Locked");
+}
 
-    return fullPathList.size() == count;
+bool GitUtil::Unlock(bool isForced, const std::vector<RepoGroup>& groups)
+{
+    return RunBatch(groups, !isForced ? Git::Template::UnlockFile : Git::Template::UnlockFileForce, "Unlock", "Unlocked");
 }
 
 bool GitUtil::Lock(const std::string& rootPath, bool isForced, const std::string& fileFullPath)
@@ -507,6 +535,147 @@ bool GitUtil::Unlock(const std::string& rootPath, bool isForced, const std::stri
     return Unlock(rootPath, isForced, fullPathList);
 }
 
+struct GitUtil::CancelToken::State
+{
+    std::atomic<bool> isCancelled;
+    std::atomic<std::chrono::steady_clock::rep> deadline;
+
+    State()
+        : isCancelled(false)
+        , deadline(std::chrono::steady_clock::time_point::max().time_since_epoch().count())
+    {
+    }
+};
+
+GitUtil::CancelToken::CancelToken()
+    : state(std::make_shared<State>())
+{
+}
+
+bool GitUtil::CancelToken::Cancel() const
+{
+    return !state->isCancelled.exchange(true);
+}
+
+void GitUtil::CancelToken::SetDeadline(std::chrono::steady_clock::time_point deadline) const
+{
+    state->deadline.store(deadline.time_since_epoch().count());
+}
+
+std::chrono::steady_clock::time_point GitUtil::CancelToken::GetDeadline() const
+{
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(state->deadline.load()));
+}
+
+bool GitUtil::CancelToken::IsCancelled() const
+{
+    return state->isCancelled.load() || IsDeadlinePassed();
+}
+
+bool GitUtil::CancelToken::IsDeadlinePassed() const
+{
+    return std::chrono::steady_clock::now().time_since_epoch().count() >= state->deadline.load();
+}
+
+namespace
+{
+    const GitUtil::CancelToken processToken;
+    std::atomic<int64_t> operationTimeout(0);
+
+    // Windows gives a console close handler about five seconds before it ends the process anyway.
+    constexpr DWORD CloseWaitTime = 4500;
+
+    std::atomic<HANDLE> reportWritten(nullptr);
+
+    BOOL WINAPI OnConsoleControl(DWORD controlType)
+    {
+        switch (controlType)
+        {
+        case CTRL_CLOSE_EVENT:
+        case CTRL_LOGOFF_EVENT:
+        case CTRL_SHUTDOWN_EVENT:
+        {
+            // The process ends as soon as this returns, so hold it until the batch has wound down and reported.
+            processToken.Cancel();
+
+            auto event = reportWritten.load();
+            if (event != nullptr)
+            {
+                WaitForSingleObject(event, CloseWaitTime);
+            }
+
+            return TRUE;
+        }
+
+        default:
+            // The first interrupt winds the batch down; a second one falls through to the default handler.
+            return processToken.Cancel() ? TRUE : FALSE;
+        }
+    }
+}
+
+void GitUtil::SetOperationTimeout(std::chrono::milliseconds timeout)
+{
+    operationTimeout.store(timeout.count());
+}
+
+std::chrono::steady_clock::time_point GitUtil::GetOperationDeadline(const CancelToken& token)
+{
+    using namespace std::chrono;
+
+    auto result = token.GetDeadline();
+
+    auto timeout = milliseconds(operationTimeout.load());
+    if (timeout.count() > 0)
+    {
+        result = std::min(result, steady_clock::now() + timeout);
+    }
+
+    return result;
+}
+
+const GitUtil::CancelToken& GitUtil::GetProcessToken()
+{
+    return processToken;
+}
+
+void GitUtil::SetDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    processToken.SetDeadline(deadline);
+}
+
+void GitUtil::Cancel()
+{
+    processToken.Cancel();
+}
+
+bool GitUtil::IsCancelled()
+{
+    return processToken.IsCancelled();
+}
+
+bool GitUtil::IsDeadlinePassed()
+{
+    return processToken.IsDeadlinePassed();
+}
+
+void GitUtil::InstallInterruptHandler()
+{
+    // Manual reset, so every close handler call returns once the report is out.
+    reportWritten.store(CreateEventA(nullptr, TRUE, FALSE, nullptr));
+    SetConsoleCtrlHandler(OnConsoleControl, TRUE);
+}
+
+void GitUtil::NotifyReportWritten()
+{
+    auto event = reportWritten.load();
+
+    if (event != nullptr)
+    {
+        SetEvent(event);
+    }
+}
+
 size_t GitUtil::UnlockAll(const std::string& rootPath, bool isForced)
 {
     std::vector<std::string> fullPathList;
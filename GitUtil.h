@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -12,6 +14,48 @@ namespace GitUtil
         std::string id;
     };
 
+    struct RepoGroup
+    {
+        std::string rootPath;
+        std::string originUrl;
+        std::vector<std::string> fileFullPathList;
+    };
+
+    struct BatchEntry
+    {
+        const RepoGroup* group;
+        const std::string* fileFullPath;
+        size_t slotIndex;
+    };
+
+    // The files of a batch interleaved across its groups, so every remote starts working right away. Groups sharing
+    // a remote share a slot index, so one server never sees more than Git::MaxRequestsPerRemote calls at once.
+    struct BatchPlan
+    {
+        std::vector<BatchEntry> entries;
+        size_t slotCount = 0;
+    };
+
+    // Stops the git calls it is passed to. Cancel kills the running ones and keeps new ones from starting, and so does
+    // passing the deadline, except that those calls are reported as timed out. Copies share their state.
+    class CancelToken
+    {
+        struct State;
+        std::shared_ptr<State> state;
+
+    public:
+        CancelToken();
+
+        // Returns false when the token was already cancelled.
+        bool Cancel() const;
+        void SetDeadline(std::chrono::steady_clock::time_point deadline) const;
+        std::chrono::steady_clock::time_point GetDeadline() const;
+
+        bool IsCancelled() const;
+        bool IsDeadlinePassed() const;
+    };
+
+    bool Exists(const char* path);
     bool IsDirectory(const char* path);
     std::vector<std::string> ListFiles(const char* path);
     void ListFilesRecursive(std::vector<std::string>& outList, const char* path);
@@ -20,15 +64,46 @@ namespace GitUtil
     std::string GetCurrentPath();
     std::string GetRepoRoot(const std::string& path);
     std::string GetOriginUrl(const std::string& rootPath);
+    std::string FindRepoRoot(const std::string& fullPath);
+    std::vector<RepoGroup> GroupByRepo(const std::vector<std::string>& fileFullPathList);
+
+    // Same grouping without the per-repository origin lookup, which GroupByRepo adds on top.
+    std::vector<RepoGroup> GroupByRepoRoot(const std::vector<std::string>& fileFullPathList);
+    std::vector<RepoGroup> MakeSingleGroup(const std::string& rootPath, const std::vector<std::string>& fileFullPathList);
+    size_t CountFiles(const std::vector<RepoGroup>& groups);
+
+    BatchPlan PlanBatch(const std::vector<RepoGroup>& groups);
+
+    // Counts the files a stopped batch never got to like the calls that were stopped. Returns true if they timed out.
+    bool CountUnscheduled(const CancelToken& token, size_t count);
 
     std::vector<LockedFileStatus> GetLockedFiles(const std::string& rootPath);
+    std::vector<LockedFileStatus> ParseLockedFiles(const std::string& output);
 
     bool IsLocked(const std::string& rootPath, const std::string& fileFullPath);
     bool Lock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fileFullPathList);
     bool Unlock(const std::string& rootPath, bool isForced, const std::vector<std::string>& fileFullPathList);
     bool Lock(const std::string& rootPath, bool isForced, const std::string& fileFullPath);
     bool Unlock(const std::string& rootPath, bool isForced, const std::string& fileFullPath);
+    bool Lock(bool isForced, const std::vector<RepoGroup>& groups);
+    bool Unlock(bool isForced, const std::vector<RepoGroup>& groups);
 
     size_t UnlockAll(const std::string& rootPath, bool isForced);
     size_t UnlockAll(const std::string& rootPath, bool isForced, const std::string& owner);
+
+    // A zero timeout means a single git call may run forever.
+    void SetOperationTimeout(std::chrono::milliseconds timeout);
+    std::chrono::steady_clock::time_point GetOperationDeadline(const CancelToken& token);
+
+    // The process-wide token the blocking calls use. Cancel, SetDeadline and the interrupt handler act on it, and
+    // once it is cancelled it stays that way, which suits a single command line run but not a long-lived embedder.
+    const CancelToken& GetProcessToken();
+    void SetDeadline(std::chrono::steady_clock::time_point deadline);
+    void Cancel();
+    bool IsCancelled();
+    bool IsDeadlinePassed();
+    void InstallInterruptHandler();
+
+    // Closing the console ends the process once the handler returns, so the handler waits for this, up to a few seconds.
+    void NotifyReportWritten();
 }
@@ -1,6 +1,13 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
+#include "GitStats.h"
 #include "GitUtil.h"
 
 
@@ -22,26 +29,29 @@ std::string GetFileFullPath(const char* path)
     return std::move(fullPath);
 }
 
-int main(int argc, char* argv[])
+std::vector<GitUtil::RepoGroup> GetRepoGroups(int argc, char* argv[])
 {
-    if (argc < 2)
+    std::vector<std::string> fullPathList;
+
+    for (int i = 2; i < argc; ++i)
     {
-        cout << "Usage: " << argv[0] << " <command>" << endl;
-        cout << "Commands:" << endl;
+        auto fullPath = GetFileFullPath(argv[i]);
+        GitUtil::ListFilesRecursive(fullPathList, fullPath.c_str());
+    }
 
-        cout << " lock <path>" << endl;
-        cout << " lock-force <path>" << endl;
-        cout << " unlock <path>" << endl;
-        cout << " unlock-force <path>" << endl;
+    auto groups = GitUtil::GroupByRepo(fullPathList);
 
-        cout << " unlock-all" << endl;
-        cout << " unlock-force-all" << endl;
-        cout << " unlock-all-owner <owner>" << endl;
-        cout << " unlock-force-all-owner <owner>" << endl;
-
-        return 0;
+    for (auto& group : groups)
+    {
+        cout << "Repository: [" << group.rootPath << "] Origin URL: [" << group.originUrl << "] Files: "
+            << group.fileFullPathList.size() << endl;
     }
 
+    return groups;
+}
+
+std::string GetCurrentRepoRoot()
+{
     auto CurPath = GitUtil::GetCurrentPath();
     cout << "Current Path: [" << CurPath << ']' << endl;
 
@@ -51,86 +61,107 @@ int main(int argc, char* argv[])
     auto originUrl = GitUtil::GetOriginUrl(rootPath);
     cout << "Origin URL: [" << originUrl << ']' << endl;
 
+    return rootPath;
+}
+
+int RunCommand(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cout << "Usage: " << argv[0] << " [--stats] [--stats-json[=<file>]] [--timeout=<seconds>] [--deadline=<seconds>] <command>" << endl;
+        cout << "Commands:" << endl;
+
+        cout << " lock <path> [<path> ...]" << endl;
+        cout << " lock-force <path> [<path> ...]" << endl;
+        cout << " unlock <path> [<path> ...]" << endl;
+        cout << " unlock-force <path> [<path> ...]" << endl;
+
+        cout << " unlock-all" << endl;
+        cout << " unlock-force-all" << endl;
+        cout << " unlock-all-owner <owner>" << endl;
+        cout << " unlock-force-all-owner <owner>" << endl;
+        cout << " list-locks" << endl;
+
+        return 0;
+    }
+
     string command = argv[1];
 
     if (command == "lock")
     {
-        if (argc != 3)
+        if (argc < 3)
         {
-            cout << "Usage: " << argv[0] << " lock <path>" << endl;
+            cout << "Usage: " << argv[0] << " lock <path> [<path> ...]" << endl;
             return -1;
         }
 
-        auto fullPath = GetFileFullPath(argv[2]);
-
-        GitUtil::Lock(rootPath, false, fullPath);
+        GitUtil::Lock(false, GetRepoGroups(argc, argv));
     }
     else if (command == "lock-force")
     {
-        if (argc != 3)
+        if (argc < 3)
         {
-            cout << "Usage: " << argv[0] << " " << command << " <path>" << endl;
+            cout << "Usage: " << argv[0] << " " << command << " <path> [<path> ...]" << endl;
             return -1;
         }
 
-        auto fullPath = GetFileFullPath(argv[2]);
-        string errorMsg;
+        auto groups = GetRepoGroups(argc, argv);
 
-        if (GitUtil::Lock(rootPath, true, fullPath))
+        if (GitUtil::Lock(true, groups))
         {
-            cout << "Locked: " << fullPath << endl;
+            cout << "Locked: " << GitUtil::CountFiles(groups) << " file(s)" << endl;
         }
         else
         {
-            cout << "Lock Failed: " << fullPath << endl;
+            cout << "Lock Failed" << endl;
         }
     }
     else if (command == "unlock")
     {
-        if (argc != 3)
+        if (argc < 3)
         {
-            cout << "Usage: " << argv[0] << " " << command << " <path>" << endl;
+            cout << "Usage: " << argv[0] << " " << command << " <path> [<path> ...]" << endl;
             return -1;
         }
 
-        auto fullPath = GetFileFullPath(argv[2]);
+        auto groups = GetRepoGroups(argc, argv);
 
-        if (GitUtil::Unlock(rootPath, false, fullPath))
+        if (GitUtil::Unlock(false, groups))
         {
-            cout << "Unlocked: " << fullPath << endl;
+            cout << "Unlocked: " << GitUtil::CountFiles(groups) << " file(s)" << endl;
         }
         else
         {
-            cout << "Unlock Failed: " << fullPath << endl;
+            cout << "Unlock Failed" << endl;
         }
     }
     else if (command == "unlock-force")
     {
-        if (argc != 3)
+        if (argc < 3)
         {
-            cout << "Usage: " << argv[0] << " " << command << " <path>" << endl;
+            cout << "Usage: " << argv[0] << " " << command << " <path> [<path> ...]" << endl;
             return -1;
         }
 
-        auto fullPath = GetFileFullPath(argv[2]);
+        auto groups = GetRepoGroups(argc, argv);
 
-        if (GitUtil::Unlock(rootPath, true, fullPath))
+        if (GitUtil::Unlock(true, groups))
         {
-            cout << "Unlocked: " << fullPath << endl;
+            cout << "Unlocked: " << GitUtil::CountFiles(groups) << " file(s)" << endl;
         }
         else
         {
-            cout << "Unlock Failed: " << fullPath << endl;
+            cout << "Unlock Failed" << endl;
         }
     }
     else if (command == "unlock-all")
     {
-        auto count = GitUtil::UnlockAll(rootPath, false);
+        auto count = GitUtil::UnlockAll(GetCurrentRepoRoot(), false);
         cout << "Total Unlocked: " << count << endl;
     }
     else if (command == "unlock-force-all")
     {
-        auto count = GitUtil::UnlockAll(rootPath, true);
+        auto count = GitUtil::UnlockAll(GetCurrentRepoRoot(), true);
         cout << "Total Unlocked: " << count << endl;
     }
     else if (command == "unlock-all-owner")
@@ -141,7 +172,7 @@ int main(int argc, char* argv[])
             return -1;
         }
 
-        auto count = GitUtil::UnlockAll(rootPath, false, argv[2]);
+        auto count = GitUtil::UnlockAll(GetCurrentRepoRoot(), false, argv[2]);
         cout << "Total Unlocked: " << count << endl;
     }
     else if (command == "unlock-force-all-owner")
@@ -152,9 +183,24 @@ int main(int argc, char* argv[])
             return -1;
         }
 
-        auto count = GitUtil::UnlockAll(rootPath, true, argv[2]);
+        auto count = GitUtil::UnlockAll(GetCurrentRepoRoot(), true, argv[2]);
         cout << "Total Unlocked: " << count << endl;
     }
+    else if (command == "list-locks")
+    {
+        size_t count = 0;
+
+        for (auto& status : GitUtil::GetLockedFiles(GetCurrentRepoRoot()))
+        {
+            if (status.filePath.empty())
+                continue;
+
+            cout << status.filePath << '\t' << status.owner << '\t' << status.id << endl;
+            ++count;
+        }
+
+        cout << "Total Locked: " << count << endl;
+    }
     else
     {
         cerr << "Unsupported command: " << command << endl;
@@ -163,3 +209,133 @@ int main(int argc, char* argv[])
 
     return 0;
 }
+
+// Longer limits are as good as none, and clamping keeps steady_clock::now() + limit far from overflowing.
+constexpr double MaxSeconds = 30.0 * 24.0 * 60.0 * 60.0;
+
+bool ParseSeconds(const string& value, chrono::milliseconds& outTime)
+{
+    char* end = nullptr;
+    auto seconds = strtod(value.c_str(), &end);
+
+    if (value.empty() || *end != '\0' || !isfinite(seconds) || seconds < 0.0)
+        return false;
+
+    seconds = min(seconds, MaxSeconds);
+    outTime = chrono::milliseconds(static_cast<long long>(seconds * 1000.0));
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    bool printStats = false;
+    bool printStatsJson = false;
+    string statsJsonPath;
+
+    vector<char*> args;
+    args.reserve(argc);
+
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if (i > 0 && arg == "--stats")
+        {
+            printStats = true;
+        }
+        else if (i > 0 && arg.compare(0, 12, "--stats-json") == 0 && (arg.size() == 12 || arg[12] == '='))
+        {
+            printStatsJson = true;
+
+            if (arg.size() > 12)
+            {
+                statsJsonPath = arg.substr(13);
+            }
+        }
+        else if (i > 0 && (arg.compare(0, 10, "--timeout=") == 0 || arg.compare(0, 11, "--deadline=") == 0))
+        {
+            auto isTimeout = (arg[2] == 't');
+            chrono::milliseconds time;
+
+            if (!ParseSeconds(arg.substr(isTimeout ? 10 : 11), time))
+            {
+                cerr << "Invalid time: " << arg << endl;
+                return -1;
+            }
+
+            if (isTimeout)
+            {
+                GitUtil::SetOperationTimeout(time);
+            }
+            else
+            {
+                GitUtil::SetDeadline(chrono::steady_clock::now() + time);
+            }
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+
+    ofstream statsJsonFile;
+
+    if (!statsJsonPath.empty())
+    {
+        statsJsonFile.open(statsJsonPath);
+
+        if (!statsJsonFile)
+        {
+            cerr << "Cannot open stats file: " << statsJsonPath << endl;
+            return -1;
+        }
+    }
+
+    GitUtil::InstallInterruptHandler();
+
+    if (printStats || printStatsJson)
+    {
+        GitStats::Enable();
+    }
+
+    // JSON on stdout must be the only thing there, so the regular progress output is dropped.
+    auto isJsonOnStdout = printStatsJson && statsJsonPath.empty();
+    auto coutBuffer = isJsonOnStdout ? cout.rdbuf(nullptr) : cout.rdbuf();
+
+    auto result = RunCommand(static_cast<int>(args.size()), args.data());
+
+    if (isJsonOnStdout)
+    {
+        cout.rdbuf(coutBuffer);
+        cout.clear();
+    }
+
+    if (printStats)
+    {
+        GitStats::PrintSummary(isJsonOnStdout ? cerr : cout);
+    }
+
+    if (printStatsJson)
+    {
+        if (isJsonOnStdout)
+        {
+            GitStats::PrintJson(cout);
+        }
+        else
+        {
+            GitStats::PrintJson(statsJsonFile);
+            statsJsonFile.close();
+
+            if (!statsJsonFile)
+            {
+                cerr << "Cannot write stats file: " << statsJsonPath << endl;
+                result = -1;
+            }
+        }
+    }
+
+    cout.flush();
+    GitUtil::NotifyReportWritten();
+
+    return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Check, timing and reporting scaffolding shared by the checks and microbenchmarks in this directory.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace Bench
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int MaxReportedFailures = 20;
+
+    inline int failureCount = 0;
+
+    // Every failure is counted, but only the first few are printed so an exhaustive check cannot flood the output.
+    inline void Check(bool condition, const std::string& message)
+    {
+        if (condition)
+            return;
+
+        if (++failureCount <= MaxReportedFailures)
+        {
+            std::cerr << "FAILED: " << message << std::endl;
+        }
+    }
+
+    // Calls func(i) for every iteration and returns the average time of one call.
+    template <typename Func>
+    double MeasureNanoseconds(size_t iterations, Func func)
+    {
+        size_t sink = 0;
+        auto start = Clock::now();
+
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            sink += func(i).size();
+        }
+
+        auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        // Keeps the loop from being optimized away.
+        if (sink == 0)
+        {
+            std::cerr << "empty output" << std::endl;
+        }
+
+        return elapsed / static_cast<double>(iterations);
+    }
+
+    inline void PrintComparison(size_t iterations, const std::string& unit, const std::string& oldName, double oldTime
+        , const std::string& newName, double newTime)
+    {
+        constexpr int NameWidth = 22;
+
+        std::cout << "iterations: " << iterations << std::endl;
+        std::cout << std::left << std::setw(NameWidth) << oldName + ":" << oldTime << " ns/" << unit << std::endl;
+        std::cout << std::left << std::setw(NameWidth) << newName + ":" << newTime << " ns/" << unit << std::endl;
+        std::cout << std::left << std::setw(NameWidth) << "speed-up:" << (newTime > 0.0 ? oldTime / newTime : 0.0) << "x" << std::endl;
+    }
+
+    // Runs the checks and, only if they all pass, the benchmark. The optional first argument is the iteration count.
+    template <typename Checks, typename Benchmark>
+    int Run(int argc, char* argv[], Checks checks, Benchmark benchmark)
+    {
+        size_t iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+        checks();
+
+        if (failureCount > 0)
+        {
+            std::cerr << failureCount << " check(s) failed" << std::endl;
+            return 1;
+        }
+
+        if (iterations > 0)
+        {
+            benchmark(iterations);
+        }
+
+        return 0;
+    }
+}
@@ -0,0 +1,142 @@
+// Compares building lock commands from parsed templates with the replace_all chain they replaced,
+// and checks that both produce the same command line and that malformed templates are rejected.
+//
+// Usage: CommandBench [iterations]
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "GitCommands.h"
+#include "GitProcess.h"
+#include "GitStrUtil.h"
+
+// GitProcess.cpp is Windows only; the benchmark always builds commands for the default git.
+const std::string& OSUtil::GetGitExecutable()
+{
+    static const std::string executable;
+    return executable;
+}
+
+namespace
+{
+    using Bench::Check;
+
+    // The way commands were built before the templates: three passes over freshly allocated strings.
+    std::string BuildOld(const std::string& command, const std::string& rootPath, const std::string& fileFullPath)
+    {
+        auto modCommand = StrUtil::replace_all(command, "<root path>", rootPath);
+        auto filePath = StrUtil::replace_all(fileFullPath, rootPath + "/", "");
+
+        return StrUtil::replace_all(modCommand, "<file path>", filePath);
+    }
+
+    std::string BuildNew(const Git::CommandTemplate& command, const std::string& rootPath, const std::string& fileFullPath)
+    {
+        return GitCommand::Build(command, rootPath, GitCommand::RelativePath(rootPath, fileFullPath));
+    }
+
+    bool Throws(std::string_view command)
+    {
+        try
+        {
+            Git::ParseCommand(command);
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+
+        return false;
+    }
+
+    void CheckEquivalence()
+    {
+        struct Case
+        {
+            const char* text;
+            const Git::CommandTemplate& parsed;
+        };
+
+        const Case cases[] = {
+            { Git::GetOriginUrl, Git::Template::GetOriginUrl },
+            { Git::GetLockedList, Git::Template::GetLockedList },
+            { Git::IsLocked, Git::Template::IsLocked },
+            { Git::LockFile, Git::Template::LockFile },
+            { Git::LockFileForce, Git::Template::LockFileForce },
+            { Git::UnlockFile, Git::Template::UnlockFile },
+            { Git::UnlockFileForce, Git::Template::UnlockFileForce },
+        };
+
+        const std::string rootPath = "C:/Work/Game";
+        const std::string files[] = {
+            "C:/Work/Game/Content/Maps/Main.umap",
+            "C:/Work/Game/a",
+            "C:/Work/GameOther/Content/Hero.uasset",
+            "D:/Elsewhere/Hero.uasset",
+        };
+
+        for (auto& item : cases)
+        {
+            for (auto& file : files)
+            {
+                auto expected = BuildOld(item.text, rootPath, file);
+                auto actual = BuildNew(item.parsed, rootPath, file);
+
+                Check(expected == actual, "[" + actual + "] should be [" + expected + "]");
+            }
+        }
+
+        Check(Git::Template::GetRepoRootPath.count == 3, "git rev-parse --show-toplevel has 3 arguments");
+        Check(GitCommand::Build(Git::Template::GetRepoRootPath) == Git::GetRepoRootPath, "commands without placeholders are kept");
+
+        // Quoting is new: the old chain passed paths with spaces to git unquoted.
+        auto quoted = BuildNew(Git::Template::IsLocked, "C:/My Work", "C:/My Work/Content/Big Map.umap");
+        Check(quoted == "git -C \"C:/My Work\" lfs locks \"--path=Content/Big Map.umap\"", "paths with spaces are quoted: " + quoted);
+    }
+
+    void CheckMalformedTemplates()
+    {
+        Check(Throws("git -C <root pth> lfs locks"), "an unknown placeholder is rejected");
+        Check(Throws("git lfs locks --path=<file path>x"), "text after a placeholder is rejected");
+        Check(Throws("git -C <root path lfs locks"), "an unterminated placeholder is rejected");
+        Check(Throws("a b c d e f g h i"), "more than MaxCommandArgs arguments are rejected");
+        Check(Throws(""), "an empty command is rejected");
+        Check(Throws("   "), "a blank command is rejected");
+        Check(!Throws("git -C <root path> lfs locks --path=<file path>"), "a valid command is accepted");
+    }
+
+    void Benchmark(size_t iterations)
+    {
+        const std::string rootPath = "C:/Work/Projects/Game";
+        std::vector<std::string> files;
+
+        for (size_t i = 0; i < 64; ++i)
+        {
+            files.push_back(rootPath + "/Content/Characters/Hero" + std::to_string(i) + "/Textures/T_Hero_D.uasset");
+        }
+
+        auto oldTime = Bench::MeasureNanoseconds(iterations, [&](size_t i)
+            {
+                return BuildOld(Git::LockFileForce, rootPath, files[i % files.size()]);
+            });
+
+        auto newTime = Bench::MeasureNanoseconds(iterations, [&](size_t i)
+            {
+                return BuildNew(Git::Template::LockFileForce, rootPath, files[i % files.size()]);
+            });
+
+        Bench::PrintComparison(iterations, "command", "replace_all x3", oldTime, "template Build", newTime);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    return Bench::Run(argc, argv, []()
+        {
+            CheckEquivalence();
+            CheckMalformedTemplates();
+        }, Benchmark);
+}
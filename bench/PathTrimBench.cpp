@@ -0,0 +1,209 @@
+// Checks the single-pass StrUtil::PathTrim against the replace_all version it replaced, exhaustively over short
+// strings and on random ones, checks ParseLockedFileResult, and then times both PathTrim versions.
+//
+// Usage: PathTrimBench [iterations]
+
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "GitStrUtil.h"
+
+namespace
+{
+    std::string Printable(const std::string& s)
+    {
+        static const char* const Digits = "0123456789abcdef";
+        std::string result = "\"";
+
+        for (unsigned char ch : s)
+        {
+            if (ch >= 0x20 && ch < 0x7f && ch != '\\')
+            {
+                result += static_cast<char>(ch);
+            }
+            else
+            {
+                result += "\\x";
+                result += Digits[ch >> 4];
+                result += Digits[ch & 0xf];
+            }
+        }
+
+        return result + "\"";
+    }
+
+    void Check(bool condition, const std::string& message, const std::string& input)
+    {
+        // Most calls pass, so the message is only put together for a failure.
+        if (!condition)
+        {
+            Bench::Check(false, message + " for " + Printable(input));
+        }
+    }
+
+    // The implementation before the single pass. One replace_all pass turns "///" into "//", so it is not idempotent.
+    void OldPathTrim(std::string& s)
+    {
+        s = StrUtil::replace_all(s, "\\", "/");
+        s = StrUtil::replace_all(s, "//", "/");
+        StrUtil::Trim(s);
+    }
+
+    // Applying the old version until nothing changes gives the result it was meant to have.
+    std::string OldPathTrimFixpoint(std::string s)
+    {
+        while (true)
+        {
+            auto previous = s;
+            OldPathTrim(s);
+
+            if (s == previous)
+                return s;
+        }
+    }
+
+    std::string NewPathTrim(std::string s)
+    {
+        StrUtil::PathTrim(s);
+        return s;
+    }
+
+    bool IsSpace(char ch)
+    {
+        return std::isspace(static_cast<unsigned char>(ch)) != 0;
+    }
+
+    void CheckPathTrim(const std::string& input)
+    {
+        auto actual = NewPathTrim(input);
+
+        Check(actual == OldPathTrimFixpoint(input), "PathTrim differs from the repeated replace_all version", input);
+        Check(NewPathTrim(actual) == actual, "PathTrim is not idempotent", input);
+        Check(actual.find("//") == std::string::npos, "PathTrim left \"//\"", input);
+        Check(actual.find('\\') == std::string::npos, "PathTrim left '\\'", input);
+        Check(actual.empty() || (!IsSpace(actual.front()) && !IsSpace(actual.back())), "PathTrim left outer whitespace", input);
+    }
+
+    void CheckPathTrimExhaustive()
+    {
+        // '\xe9' is a byte above 0x7f, which std::isspace must not see as a negative value.
+        const std::string alphabet = "a/\\ \xe9";
+        constexpr size_t MaxLength = 7;
+
+        std::vector<size_t> digits;
+
+        for (size_t length = 0; length <= MaxLength; ++length)
+        {
+            digits.assign(length, 0);
+
+            while (true)
+            {
+                std::string input;
+                for (auto digit : digits)
+                {
+                    input += alphabet[digit];
+                }
+
+                CheckPathTrim(input);
+
+                size_t i = 0;
+                while (i < length && ++digits[i] == alphabet.size())
+                {
+                    digits[i++] = 0;
+                }
+
+                if (i == length)
+                    break;
+            }
+        }
+    }
+
+    void CheckPathTrimRandom(size_t count)
+    {
+        const std::string alphabet = "ab./\\ \t\r\n\xa0\xff";
+        std::mt19937 random(12345);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string input(random() % 40, ' ');
+
+            for (auto& ch : input)
+            {
+                ch = alphabet[random() % alphabet.size()];
+            }
+
+            CheckPathTrim(input);
+        }
+    }
+
+    void CheckLockedFile(const std::string& line, const std::string& filePath, const std::string& owner, const std::string& id)
+    {
+        auto input = line;
+        auto status = StrUtil::ParseLockedFileResult(input);
+
+        Check(status.filePath == filePath, "filePath is [" + status.filePath + "], expected [" + filePath + "]", line);
+        Check(status.owner == owner, "owner is [" + status.owner + "], expected [" + owner + "]", line);
+        Check(status.id == id, "id is [" + status.id + "], expected [" + id + "]", line);
+    }
+
+    void CheckParseLockedFileResult()
+    {
+        CheckLockedFile("Content/Maps/Main.umap\tjane\tID:12", "Content/Maps/Main.umap", "jane", "ID:12");
+        CheckLockedFile("Content/Big Map.umap  \t John Smith \t ID:7 \r", "Content/Big Map.umap", "John Smith", "ID:7");
+        CheckLockedFile("Content/Hero.uasset\tJos\xc3\xa9\tID:3", "Content/Hero.uasset", "Jos\xc3\xa9", "ID:3");
+        CheckLockedFile("Content/Hero.uasset\tjane\t", "Content/Hero.uasset", "jane", "");
+        CheckLockedFile("Content/Hero.uasset\tjane", "", "", "");
+        CheckLockedFile("Content/Hero.uasset", "", "", "");
+        CheckLockedFile("", "", "", "");
+    }
+
+    void CheckTrim()
+    {
+        // Bytes above 0x7f are not whitespace and must survive.
+        auto input = std::string(" \t\xe9x\xa0\n");
+        Check(StrUtil::TrimCopy(input) == "\xe9x\xa0", "Trim removed a non-ASCII byte", input);
+        Check(StrUtil::TrimCopy(" \t\r\n") == "", "Trim left whitespace", " \t\r\n");
+    }
+
+    void Benchmark(size_t iterations)
+    {
+        std::vector<std::string> inputs;
+
+        for (size_t i = 0; i < 64; ++i)
+        {
+            inputs.push_back("  C:\\Work\\Projects\\Game\\Content\\Characters\\Hero" + std::to_string(i) + "\\Textures\\T_Hero_D.uasset\n");
+            inputs.push_back("C:/Work/Projects/Game/Content/Characters/Hero" + std::to_string(i) + "/Textures/T_Hero_D.uasset");
+        }
+
+        // Both sides pay for the same copy of the input, so the difference is the trimming itself.
+        auto oldTime = Bench::MeasureNanoseconds(iterations, [&inputs](size_t i)
+            {
+                auto path = inputs[i % inputs.size()];
+                OldPathTrim(path);
+                return path;
+            });
+
+        auto newTime = Bench::MeasureNanoseconds(iterations, [&inputs](size_t i)
+            {
+                auto path = inputs[i % inputs.size()];
+                StrUtil::PathTrim(path);
+                return path;
+            });
+
+        Bench::PrintComparison(iterations, "path", "replace_all PathTrim", oldTime, "single-pass PathTrim", newTime);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    return Bench::Run(argc, argv, []()
+        {
+            CheckTrim();
+            CheckPathTrimExhaustive();
+            CheckPathTrimRandom(200000);
+            CheckParseLockedFileResult();
+        }, Benchmark);
+}
@@ -0,0 +1,3 @@
+@echo off
+rem Lets GIT_LFS_LOCK_HELPER_GIT point at fake_git.py; CreateProcess cannot start a .py file directly.
+python "%~dp0fake_git.py" %*
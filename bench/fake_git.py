@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Stand-in for the git and git-lfs commands GitLfsLockHelper runs.
+
+Point GIT_LFS_LOCK_HELPER_GIT at fake_git.cmd (Windows) or this script, and
+FAKE_LFS_SERVER at a running mock_lock_server.py. Supported commands:
+
+  git [-C dir] rev-parse --show-toplevel
+  git [-C dir] remote get-url origin
+  git [-C dir] lfs locks [--path=<path>]
+  git [-C dir] lfs lock [-f] <path>
+  git [-C dir] lfs unlock [-f] <path>
+
+Environment:
+  FAKE_LFS_SERVER          lock server URL, default http://127.0.0.1:8080
+  FAKE_LFS_OWNER           lock owner name, default the current user
+  FAKE_GIT_ORIGIN          origin URL reported by remote get-url
+  FAKE_GIT_LATENCY_MS      client-side delay before each lfs command
+  FAKE_GIT_JITTER_MS       random +/- added to that delay
+  FAKE_GIT_FAILURE_RATE    fraction of lfs commands that fail before contacting the server
+"""
+
+import fnmatch
+import getpass
+import json
+import os
+import random
+import sys
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+
+RequestTimeout = 60
+
+
+def fail(message, code=2):
+    sys.stderr.write(message + "\n")
+    sys.exit(code)
+
+
+def server_url():
+    return os.environ.get("FAKE_LFS_SERVER", "http://127.0.0.1:8080").rstrip("/")
+
+
+def owner():
+    if "FAKE_LFS_OWNER" in os.environ:
+        return os.environ["FAKE_LFS_OWNER"]
+
+    try:
+        return getpass.getuser()
+    except Exception:
+        return "bench"
+
+
+def find_toplevel(path):
+    path = os.path.abspath(path)
+
+    while True:
+        if os.path.exists(os.path.join(path, ".git")):
+            return path
+
+        parent = os.path.dirname(path)
+        if parent == path:
+            return None
+
+        path = parent
+
+
+def to_git_path(path):
+    return path.replace("\\", "/")
+
+
+def simulate_client():
+    latency = float(os.environ.get("FAKE_GIT_LATENCY_MS", "0"))
+    jitter = float(os.environ.get("FAKE_GIT_JITTER_MS", "0"))
+    delay = latency + random.uniform(-jitter, jitter)
+
+    if delay > 0:
+        time.sleep(delay / 1000.0)
+
+    if random.random() < float(os.environ.get("FAKE_GIT_FAILURE_RATE", "0")):
+        fail("batch response: simulated client failure")
+
+
+def request(method, path, body=None):
+    data = None if body is None else json.dumps(body).encode("utf-8")
+    req = urllib.request.Request(server_url() + path, data=data, method=method
+        , headers={"Content-Type": "application/json"})
+
+    try:
+        with urllib.request.urlopen(req, timeout=RequestTimeout) as response:
+            return response.status, json.loads(response.read() or b"{}")
+    except urllib.error.HTTPError as error:
+        return error.code, json.loads(error.read() or b"{}")
+    except (urllib.error.URLError, OSError) as error:
+        fail("batch response: %s" % error)
+
+
+def is_lockable(toplevel, path):
+    attributes = os.path.join(toplevel, ".gitattributes")
+
+    if not os.path.exists(attributes):
+        return False
+
+    name = os.path.basename(path)
+
+    with open(attributes) as file:
+        for line in file:
+            fields = line.split()
+
+            if len(fields) >= 2 and "lockable" in fields[1:] and fnmatch.fnmatch(name, fields[0]):
+                return True
+
+    return False
+
+
+def lfs_locks(toplevel, args):
+    simulate_client()
+
+    query = ""
+    for arg in args:
+        if arg.startswith("--path="):
+            query = "?" + urllib.parse.urlencode({"path": to_git_path(arg[len("--path="):])})
+
+    status, body = request("GET", "/locks" + query)
+
+    if status != 200:
+        fail("Error while retrieving locks: %s" % body.get("message", status))
+
+    for lock in body.get("locks", []):
+        sys.stdout.write("%s\t%s\tID:%s\n" % (lock["path"], lock["owner"], lock["id"]))
+
+
+def lfs_lock(toplevel, args, is_unlock):
+    force = "-f" in args or "--force" in args
+    paths = [arg for arg in args if not arg.startswith("-")]
+
+    if len(paths) != 1:
+        fail("Usage: git lfs %s [-f] <path>" % ("unlock" if is_unlock else "lock"))
+
+    path = to_git_path(paths[0])
+
+    if not is_unlock and not is_lockable(toplevel, path):
+        fail("Lock failed: %s is not lockable" % path)
+
+    simulate_client()
+
+    endpoint = "/locks/unlock" if is_unlock else "/locks"
+    status, body = request("POST", endpoint, {"path": path, "owner": owner(), "force": force})
+
+    if status in (200, 201):
+        sys.stdout.write("%s %s\n" % ("Unlocked" if is_unlock else "Locked", path))
+        return
+
+    fail("%s failed: %s" % ("Unlock" if is_unlock else "Lock", body.get("message", status)))
+
+
+def main(argv):
+    cwd = os.getcwd()
+
+    while len(argv) >= 2 and argv[0] == "-C":
+        cwd = os.path.join(cwd, argv[1])
+        argv = argv[2:]
+
+    toplevel = find_toplevel(cwd)
+
+    if argv[:2] == ["rev-parse", "--show-toplevel"]:
+        if toplevel is None:
+            fail("fatal: not a git repository (or any of the parent directories): .git", 128)
+
+        sys.stdout.write(to_git_path(toplevel) + "\n")
+        return
+
+    if toplevel is None:
+        fail("fatal: not a git repository (or any of the parent directories): .git", 128)
+
+    if argv[:3] == ["remote", "get-url", "origin"]:
+        origin = os.environ.get("FAKE_GIT_ORIGIN", "https://lfs.invalid/%s.git" % os.path.basename(toplevel))
+        sys.stdout.write(origin + "\n")
+    elif argv[:2] == ["lfs", "locks"]:
+        lfs_locks(toplevel, argv[2:])
+    elif argv[:2] == ["lfs", "lock"]:
+        lfs_lock(toplevel, argv[2:], False)
+    elif argv[:2] == ["lfs", "unlock"]:
+        lfs_lock(toplevel, argv[2:], True)
+    else:
+        fail("fake_git: unsupported command: %s" % " ".join(argv), 1)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
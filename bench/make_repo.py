@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Generates a synthetic working tree for lock benchmarks.
+
+The tree gets a .git directory, so fake_git.py finds its top level, and a
+.gitattributes that marks *.uasset as lockable. A --lockable-ratio share of
+the files are .uasset and the rest use non-lockable extensions, which makes
+the helper walk, and attempt, realistic mixes of files. Prints a JSON
+summary of what was written.
+"""
+
+import argparse
+import json
+import os
+import random
+import sys
+
+LockableExtension = ".uasset"
+OtherExtensions = [".txt", ".ini", ".json", ".cpp", ".h"]
+
+
+def make_directories(root, depth, fanout):
+    directories = [root]
+    level = [root]
+
+    for d in range(depth):
+        next_level = []
+
+        for parent in level:
+            for i in range(fanout):
+                path = os.path.join(parent, "Dir%d_%d" % (d, i))
+                next_level.append(path)
+
+        directories.extend(next_level)
+        level = next_level
+
+    for path in directories:
+        os.makedirs(path, exist_ok=True)
+
+    return directories
+
+
+def make_repo(root, files, depth, fanout, lockable_ratio, file_size, seed):
+    rng = random.Random(seed)
+
+    os.makedirs(os.path.join(root, ".git"), exist_ok=True)
+
+    with open(os.path.join(root, ".git", "HEAD"), "w") as file:
+        file.write("ref: refs/heads/main\n")
+
+    with open(os.path.join(root, ".gitattributes"), "w") as file:
+        file.write("*%s filter=lfs diff=lfs merge=lfs -text lockable\n" % LockableExtension)
+
+    content = os.path.join(root, "Content")
+    directories = make_directories(content, depth, fanout)
+
+    lockable = 0
+    payload = b"\0" * file_size
+
+    for i in range(files):
+        if rng.random() < lockable_ratio:
+            extension = LockableExtension
+            lockable += 1
+        else:
+            extension = rng.choice(OtherExtensions)
+
+        directory = directories[i % len(directories)]
+
+        with open(os.path.join(directory, "Asset%06d%s" % (i, extension)), "wb") as file:
+            file.write(payload)
+
+    return {
+        "root": os.path.abspath(root),
+        "content": os.path.abspath(content),
+        "files": files,
+        "lockable_files": lockable,
+        "directories": len(directories),
+        "depth": depth,
+        "fanout": fanout,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("root", help="directory to create the repository in")
+    parser.add_argument("--files", type=int, default=1000)
+    parser.add_argument("--depth", type=int, default=3, help="directory levels under Content")
+    parser.add_argument("--fanout", type=int, default=4, help="subdirectories per directory")
+    parser.add_argument("--lockable-ratio", type=float, default=0.8)
+    parser.add_argument("--file-size", type=int, default=0, help="bytes written to each file")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    summary = make_repo(args.root, args.files, args.depth, args.fanout, args.lockable_ratio, args.file_size, args.seed)
+    json.dump(summary, sys.stdout, indent=2)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""Local stand-in for an LFS lock server.
+
+Keeps locks in memory and serves the small JSON protocol fake_git.py speaks.
+Latency, jitter, throttling and failures are configurable so lock-path
+changes can be measured against a reproducible, offline server.
+
+  POST /locks          {"path", "owner", "force"}  -> 201 | 409
+  POST /locks/unlock   {"path", "owner", "force"}  -> 200 | 403 | 404
+  GET  /locks[?path=]                              -> {"locks": [...]}
+  GET  /stats                                      -> server counters
+  POST /reset                                      -> clears locks and counters
+"""
+
+import argparse
+import json
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+class LockState:
+    def __init__(self, args):
+        self.args = args
+        self.random = random.Random(args.seed)
+        self.lock = threading.Lock()
+        self.reset()
+
+    def reset(self):
+        with self.lock:
+            self.locks = {}
+            self.next_id = 1
+            self.tokens = float(self.args.rate_limit)
+            self.last_refill = time.monotonic()
+            self.active = 0
+            self.counters = {
+                "requests": 0,
+                "throttled": 0,
+                "failed": 0,
+                "locked": 0,
+                "unlocked": 0,
+                "conflicts": 0,
+                "max_concurrent": 0,
+            }
+
+    def admit(self):
+        """Returns None when the request may run, otherwise the HTTP status to answer with."""
+        with self.lock:
+            self.counters["requests"] += 1
+
+            if self.args.rate_limit > 0:
+                now = time.monotonic()
+                self.tokens = min(float(self.args.rate_limit),
+                                  self.tokens + (now - self.last_refill) * self.args.rate_limit)
+                self.last_refill = now
+
+                if self.tokens < 1.0:
+                    self.counters["throttled"] += 1
+                    return 429
+
+                self.tokens -= 1.0
+
+            if self.args.max_concurrent > 0 and self.active >= self.args.max_concurrent:
+                self.counters["throttled"] += 1
+                return 429
+
+            if self.random.random() < self.args.failure_rate:
+                self.counters["failed"] += 1
+                return 500
+
+            self.active += 1
+            self.counters["max_concurrent"] = max(self.counters["max_concurrent"], self.active)
+            delay = self.args.latency_ms + self.random.uniform(-self.args.jitter_ms, self.args.jitter_ms)
+
+        time.sleep(max(delay, 0.0) / 1000.0)
+        return None
+
+    def release(self):
+        with self.lock:
+            self.active -= 1
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, format, *args):
+        pass
+
+    def reply(self, status, body):
+        data = json.dumps(body).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def read_body(self):
+        length = int(self.headers.get("Content-Length", "0"))
+        return json.loads(self.rfile.read(length) or b"{}")
+
+    def run_locked_request(self, action):
+        state = self.server.state
+        rejected = state.admit()
+
+        if rejected is not None:
+            message = "rate limited" if rejected == 429 else "internal server error"
+            self.reply(rejected, {"message": message})
+            return
+
+        try:
+            status, body = action(state)
+        finally:
+            state.release()
+
+        self.reply(status, body)
+
+    def do_GET(self):
+        url = urlparse(self.path)
+
+        if url.path == "/stats":
+            state = self.server.state
+            with state.lock:
+                body = dict(state.counters, active_locks=len(state.locks))
+            self.reply(200, body)
+        elif url.path == "/locks":
+            path = parse_qs(url.query).get("path", [None])[0]
+            self.run_locked_request(lambda state: self.list_locks(state, path))
+        else:
+            self.reply(404, {"message": "not found"})
+
+    def do_POST(self):
+        url = urlparse(self.path)
+        body = self.read_body()
+
+        if url.path == "/reset":
+            self.server.state.reset()
+            self.reply(200, {})
+        elif url.path == "/locks":
+            self.run_locked_request(lambda state: self.create_lock(state, body))
+        elif url.path == "/locks/unlock":
+            self.run_locked_request(lambda state: self.delete_lock(state, body))
+        else:
+            self.reply(404, {"message": "not found"})
+
+    @staticmethod
+    def list_locks(state, path):
+        with state.lock:
+            locks = [lock for lock in state.locks.values() if path is None or lock["path"] == path]
+        return 200, {"locks": sorted(locks, key=lambda lock: lock["path"])}
+
+    @staticmethod
+    def create_lock(state, body):
+        path = body["path"]
+        owner = body.get("owner", "")
+
+        with state.lock:
+            existing = state.locks.get(path)
+
+            if existing is not None and not (body.get("force") and existing["owner"] == owner):
+                state.counters["conflicts"] += 1
+                return 409, {"message": "lock exists", "lock": existing}
+
+            lock = {"id": str(state.next_id), "path": path, "owner": owner}
+            state.next_id += 1
+            state.locks[path] = lock
+            state.counters["locked"] += 1
+
+        return 201, {"lock": lock}
+
+    @staticmethod
+    def delete_lock(state, body):
+        path = body["path"]
+        owner = body.get("owner", "")
+
+        with state.lock:
+            existing = state.locks.get(path)
+
+            if existing is None:
+                return 404, {"message": "no lock"}
+
+            if existing["owner"] != owner and not body.get("force"):
+                state.counters["conflicts"] += 1
+                return 403, {"message": "owned by " + existing["owner"]}
+
+            del state.locks[path]
+            state.counters["unlocked"] += 1
+
+        return 200, {"lock": existing}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=0, help="0 picks a free port")
+    parser.add_argument("--port-file", help="write the bound port here once listening")
+    parser.add_argument("--latency-ms", type=float, default=20.0)
+    parser.add_argument("--jitter-ms", type=float, default=5.0)
+    parser.add_argument("--rate-limit", type=float, default=0.0, help="requests per second, 0 disables")
+    parser.add_argument("--max-concurrent", type=int, default=0, help="concurrent requests, 0 disables")
+    parser.add_argument("--failure-rate", type=float, default=0.0, help="fraction answered with HTTP 500")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer((args.host, args.port), Handler)
+    server.daemon_threads = True
+    server.request_queue_size = 1024
+    server.state = LockState(args)
+
+    port = server.server_address[1]
+    if args.port_file:
+        with open(args.port_file, "w") as file:
+            file.write(str(port))
+
+    print("mock lock server listening on %s:%d" % (args.host, port), flush=True)
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,370 @@
+#!/usr/bin/env python3
+"""End-to-end lock benchmark.
+
+Generates a synthetic repository, starts mock_lock_server.py, points the helper
+at fake_git.py through GIT_LFS_LOCK_HELPER_GIT and runs this scenario:
+
+  lock Content -> list-locks -> unlock Content -> lock Content -> unlock-all
+
+Each step records wall time, throughput, the server-side request counters,
+the helper's own --stats-json output and, where the platform allows it, the
+helper's peak RSS, thread count and number of live git children. Results are
+written as JSON.
+
+  run_bench.py --helper x64/Release/GitLfsLockHelper.exe --files 2000 --out result.json
+  run_bench.py --baseline --files 200
+
+--baseline replays what the helper originally did, one git call per file on
+up to 128 threads that are joined a batch at a time (Git::MultiThreadTask(128)),
+and needs nothing but Python. --baseline-jobs 1 turns it into a naive
+sequential reference instead.
+
+--helper runs GitLfsLockHelper.exe and so only works on Windows. Elsewhere only
+the Python baseline runs, which measures the mock server and the fake git but
+none of the helper's own lock, unlock, unlock-all or list-locks code.
+"""
+
+import argparse
+import json
+import os
+import shlex
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.request
+
+import make_repo
+
+BenchDir = os.path.dirname(os.path.abspath(__file__))
+SampleInterval = 0.01
+Owner = "bench"
+
+try:
+    import psutil
+except ImportError:
+    psutil = None
+
+
+class ProcessSampler:
+    """Polls the measured process for peak memory, threads and children."""
+
+    def __init__(self, pid):
+        self.pid = pid
+        self.peak_rss = None
+        self.peak_threads = None
+        self.peak_children = None
+        self.stopping = threading.Event()
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def stop(self):
+        self.stopping.set()
+        self.thread.join()
+
+    def update(self, name, value):
+        if value is not None:
+            current = getattr(self, name)
+            setattr(self, name, value if current is None else max(current, value))
+
+    def sample_psutil(self, process):
+        with process.oneshot():
+            self.update("peak_rss", process.memory_info().rss)
+            self.update("peak_threads", process.num_threads())
+
+        self.update("peak_children", len(process.children(recursive=True)))
+
+    def sample_proc(self):
+        with open("/proc/%d/status" % self.pid) as file:
+            for line in file:
+                if line.startswith("VmHWM:"):
+                    self.update("peak_rss", int(line.split()[1]) * 1024)
+                elif line.startswith("Threads:"):
+                    self.update("peak_threads", int(line.split()[1]))
+
+    def run(self):
+        process = psutil.Process(self.pid) if psutil is not None else None
+
+        while not self.stopping.is_set():
+            try:
+                if process is not None:
+                    self.sample_psutil(process)
+                elif os.path.exists("/proc/%d/status" % self.pid):
+                    self.sample_proc()
+                else:
+                    return
+            except Exception:
+                return
+
+            self.stopping.wait(SampleInterval)
+
+
+class MockServer:
+    def __init__(self, args, workdir):
+        port_file = os.path.join(workdir, "server.port")
+        command = [sys.executable, os.path.join(BenchDir, "mock_lock_server.py"), "--port-file", port_file
+            , "--latency-ms", str(args.latency_ms), "--jitter-ms", str(args.jitter_ms)
+            , "--rate-limit", str(args.rate_limit), "--max-concurrent", str(args.max_concurrent)
+            , "--failure-rate", str(args.failure_rate), "--seed", str(args.seed)]
+
+        self.process = subprocess.Popen(command, stdout=subprocess.DEVNULL)
+
+        deadline = time.monotonic() + 10
+        while not os.path.exists(port_file) or os.path.getsize(port_file) == 0:
+            if time.monotonic() > deadline or self.process.poll() is not None:
+                self.close()
+                raise RuntimeError("mock lock server did not start")
+
+            time.sleep(0.05)
+
+        with open(port_file) as file:
+            self.url = "http://127.0.0.1:%s" % file.read().strip()
+
+    def call(self, method, path):
+        data = b"{}" if method == "POST" else None
+        request = urllib.request.Request(self.url + path, data=data, method=method)
+
+        with urllib.request.urlopen(request, timeout=30) as response:
+            return json.loads(response.read() or b"{}")
+
+    def close(self):
+        self.process.terminate()
+        self.process.wait()
+
+
+def counter_delta(before, after):
+    delta = {key: after[key] - before.get(key, 0) for key in after if key not in ("max_concurrent", "active_locks")}
+    delta["max_concurrent"] = after["max_concurrent"]
+    delta["active_locks"] = after["active_locks"]
+    return delta
+
+
+def fake_git_command():
+    if os.name == "nt":
+        return os.path.join(BenchDir, "fake_git.cmd")
+
+    script = os.path.join(BenchDir, "fake_git.py")
+    os.chmod(script, os.stat(script).st_mode | 0o111)
+    return script
+
+
+def make_env(args, server):
+    env = dict(os.environ)
+    env["GIT_LFS_LOCK_HELPER_GIT"] = fake_git_command()
+    env["FAKE_LFS_SERVER"] = server.url
+    env["FAKE_LFS_OWNER"] = Owner
+    env["FAKE_GIT_LATENCY_MS"] = str(args.client_latency_ms)
+    env["FAKE_GIT_JITTER_MS"] = str(args.client_jitter_ms)
+    env["FAKE_GIT_FAILURE_RATE"] = str(args.client_failure_rate)
+    return env
+
+
+def run_helper(args, repo, env, step, workdir):
+    stats_path = os.path.join(workdir, "stats.json")
+    log_path = os.path.join(workdir, "%s.log" % "-".join(step).replace("/", "_"))
+
+    if os.path.exists(stats_path):
+        os.remove(stats_path)
+
+    command = shlex.split(args.helper, posix=(os.name != "nt")) + ["--stats-json=" + stats_path]
+
+    if args.timeout > 0:
+        command.append("--timeout=%g" % args.timeout)
+
+    command += step
+
+    with open(log_path, "w") as log:
+        start = time.perf_counter()
+        process = subprocess.Popen(command, cwd=repo["root"], env=env, stdout=log, stderr=subprocess.STDOUT)
+        sampler = ProcessSampler(process.pid)
+        exit_code = process.wait()
+        wall = time.perf_counter() - start
+        sampler.stop()
+
+    helper_stats = None
+    if os.path.exists(stats_path):
+        with open(stats_path) as file:
+            try:
+                helper_stats = json.load(file)
+            except ValueError:
+                helper_stats = None
+
+    return {
+        "exit_code": exit_code,
+        "wall_seconds": wall,
+        "peak_rss_bytes": sampler.peak_rss,
+        "peak_threads": sampler.peak_threads,
+        "peak_children": sampler.peak_children,
+        "helper_stats": helper_stats,
+    }
+
+
+def list_files(path):
+    result = []
+
+    for directory, _, names in os.walk(path):
+        result.extend(os.path.join(directory, name) for name in names)
+
+    return sorted(result)
+
+
+def run_baseline(args, repo, env, step, workdir):
+    git = [sys.executable, os.path.join(BenchDir, "fake_git.py"), "-C", repo["root"]]
+
+    def git_call(*arguments):
+        return subprocess.run(git + list(arguments), env=env, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL
+            , universal_newlines=True)
+
+    def locked_paths():
+        output = git_call("lfs", "locks").stdout
+        return [line.split("\t")[0] for line in output.splitlines() if line]
+
+    def run_all(verb, paths):
+        # Like Git::MultiThreadTask: start threads until the pool is full, then join all of them before going on.
+        for offset in range(0, len(paths), args.baseline_jobs):
+            pool = [threading.Thread(target=git_call, args=("lfs", verb, path))
+                for path in paths[offset:offset + args.baseline_jobs]]
+
+            for thread in pool:
+                thread.start()
+
+            for thread in pool:
+                thread.join()
+
+    start = time.perf_counter()
+    exit_code = 0
+
+    if step[0] in ("lock", "unlock"):
+        paths = list_files(os.path.join(repo["root"], step[1]))
+        run_all(step[0], [os.path.relpath(path, repo["root"]).replace("\\", "/") for path in paths])
+    elif step[0] == "list-locks":
+        locked_paths()
+    elif step[0] == "unlock-all":
+        run_all("unlock", locked_paths())
+    else:
+        exit_code = -1
+
+    return {
+        "exit_code": exit_code,
+        "wall_seconds": time.perf_counter() - start,
+        "peak_rss_bytes": None,
+        "peak_threads": None,
+        "peak_children": None,
+        "helper_stats": None,
+    }
+
+
+def summarize(results):
+    summary = {}
+
+    for result in results:
+        summary.setdefault(result["step"], []).append(result["wall_seconds"])
+
+    return {
+        step: {"median_seconds": statistics.median(times), "min_seconds": min(times), "max_seconds": max(times)}
+        for step, times in summary.items()
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    mode = parser.add_mutually_exclusive_group(required=True)
+    mode.add_argument("--helper", help="helper command line, e.g. the path to GitLfsLockHelper.exe")
+    mode.add_argument("--baseline", action="store_true", help="one-call-per-file reference run, see --baseline-jobs")
+
+    parser.add_argument("--files", type=int, default=1000)
+    parser.add_argument("--depth", type=int, default=3)
+    parser.add_argument("--fanout", type=int, default=4)
+    parser.add_argument("--lockable-ratio", type=float, default=0.8)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--repeat", type=int, default=3)
+
+    parser.add_argument("--latency-ms", type=float, default=20.0, help="server latency per request")
+    parser.add_argument("--jitter-ms", type=float, default=5.0)
+    parser.add_argument("--rate-limit", type=float, default=0.0, help="server requests per second, 0 disables")
+    parser.add_argument("--max-concurrent", type=int, default=0, help="server concurrency limit, 0 disables")
+    parser.add_argument("--failure-rate", type=float, default=0.0, help="server HTTP 500 fraction")
+    parser.add_argument("--client-latency-ms", type=float, default=0.0, help="git-lfs startup delay per call")
+    parser.add_argument("--client-jitter-ms", type=float, default=0.0)
+    parser.add_argument("--client-failure-rate", type=float, default=0.0)
+
+    parser.add_argument("--baseline-jobs", type=int, default=128
+        , help="threads per batch in --baseline mode; 128 as in the original helper, 1 for a sequential run")
+    parser.add_argument("--timeout", type=float, default=0.0, help="passed to the helper as --timeout")
+    parser.add_argument("--workdir", help="keep the generated repository and logs here")
+    parser.add_argument("--out", help="write the JSON result here instead of stdout")
+    args = parser.parse_args()
+
+    if args.baseline_jobs < 1:
+        parser.error("--baseline-jobs must be at least 1")
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="lfs-lock-bench-")
+    os.makedirs(workdir, exist_ok=True)
+
+    repo_root = os.path.join(workdir, "repo")
+    if os.path.exists(repo_root):
+        shutil.rmtree(repo_root)
+
+    repo = make_repo.make_repo(repo_root, args.files, args.depth, args.fanout, args.lockable_ratio, 0, args.seed)
+    server = MockServer(args, workdir)
+    run_step = run_baseline if args.baseline else run_helper
+
+    steps = [("lock", ["lock", "Content"]), ("list-locks", ["list-locks"]), ("unlock", ["unlock", "Content"])
+        , ("relock", ["lock", "Content"]), ("unlock-all", ["unlock-all"])]
+    results = []
+
+    try:
+        env = make_env(args, server)
+
+        for repeat in range(args.repeat):
+            server.call("POST", "/reset")
+
+            for name, step in steps:
+                before = server.call("GET", "/stats")
+                result = run_step(args, repo, env, step, workdir)
+                server_delta = counter_delta(before, server.call("GET", "/stats"))
+
+                attempted = repo["files"] if step[0] in ("lock", "unlock") else server_delta["requests"]
+                result.update({
+                    "repeat": repeat,
+                    "step": name,
+                    "command": step,
+                    "files": attempted,
+                    "files_per_second": attempted / result["wall_seconds"] if result["wall_seconds"] > 0 else None,
+                    "server": server_delta,
+                })
+                results.append(result)
+
+                print("[%d] %-16s %8.3fs exit=%d locks=%d" % (repeat, result["step"], result["wall_seconds"]
+                    , result["exit_code"], server_delta["active_locks"]), file=sys.stderr)
+    finally:
+        server.close()
+
+        if not args.workdir:
+            shutil.rmtree(workdir, ignore_errors=True)
+
+    report = {
+        "mode": "baseline" if args.baseline else "helper",
+        "helper": args.helper,
+        "platform": sys.platform,
+        "config": {key: value for key, value in vars(args).items() if key not in ("out", "workdir")},
+        "repo": {key: repo[key] for key in ("files", "lockable_files", "directories", "depth", "fanout")},
+        "results": results,
+        "summary": summarize(results),
+    }
+
+    if args.out:
+        with open(args.out, "w") as file:
+            json.dump(report, file, indent=2)
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        sys.stdout.write("\n")
+
+    return 1 if any(result["exit_code"] != 0 for result in results) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())